@@ -52,6 +52,10 @@ typedef struct I3ipc_reply_config           I3ipc_reply_config;
 typedef struct I3ipc_reply_tick             I3ipc_reply_tick;
 typedef struct I3ipc_reply_sync             I3ipc_reply_sync;
 typedef union  I3ipc_event                  I3ipc_event;
+typedef struct I3ipc_node                   I3ipc_node;
+typedef struct I3ipc_lazy_tree              I3ipc_lazy_tree;
+typedef struct I3ipc_raw                    I3ipc_raw;
+typedef struct I3ipc_flat_tree              I3ipc_flat_tree;
 
 /* *** Core API *** */
 
@@ -59,7 +63,7 @@ typedef union  I3ipc_event                  I3ipc_event;
 void i3ipc_run_command_simple(char const* command);
 
 /* Run a command and return results.
- * You have to free() the result, unless staticalloc is set. */
+ * You have to free the result with i3ipc_free, unless staticalloc is set. */
 I3ipc_reply_command* i3ipc_run_command(char const* commands);
 
 /* Subscribe to events of that type.
@@ -74,7 +78,7 @@ void i3ipc_subscribe(int* event_type, int event_type_size);
 /* Wait for the next event, and return it.
  * If timeout_ms milliseconds elapse before an event arrives, return NULL.
  * Negative timeout_ms causes this to wait forever, zero has it return immediately.
- * You have to free() the result, unless staticalloc is set. */
+ * You have to free the result with i3ipc_free, unless staticalloc is set. */
 I3ipc_event* i3ipc_event_next(int timeout_ms);
 
 /* Query only major, minor and patch numbers.
@@ -83,7 +87,7 @@ I3ipc_event* i3ipc_event_next(int timeout_ms);
 void i3ipc_get_version_simple(int* out_major, int* out_minor, int* out_patch);
 
 /* Query the specified information.
- * You have to free() the result, unless staticalloc is set. */
+ * You have to free the result with i3ipc_free, unless staticalloc is set. */
 I3ipc_reply_workspaces*     i3ipc_get_workspaces(void);
 I3ipc_reply_outputs*        i3ipc_get_outputs(void);
 I3ipc_reply_tree*           i3ipc_get_tree(void);
@@ -95,9 +99,54 @@ I3ipc_reply_config*         i3ipc_get_config(void);
 
 /* Query the bar configuration of that name.
  * A list of names can be queried by i3ipc_get_bar_config_ids.
- * You have to free() the result, unless staticalloc is set. */
+ * You have to free the result with i3ipc_free, unless staticalloc is set. */
 I3ipc_reply_bar_config* i3ipc_get_bar_config(char const* name);
 
+/* Query the tree, but decode nodes only when they are needed, see i3ipc_lazy_expand. This is
+ * faster if you only look at a part of the tree, e.g. the path to the focused window.
+ * You have to free the result with i3ipc_lazy_free, regardless of staticalloc. */
+I3ipc_lazy_tree* i3ipc_get_tree_lazy(void);
+
+/* Return the root node of the tree. */
+I3ipc_node* i3ipc_lazy_root(I3ipc_lazy_tree* tree);
+
+/* Decode the children of node, which must be part of tree. These are the members nodes,
+ * floating_nodes and window_properties, which are NULL until then. The children are not expanded
+ * themselves. Expanding a node again does nothing. Return node, or NULL on error. */
+I3ipc_node* i3ipc_lazy_expand(I3ipc_lazy_tree* tree, I3ipc_node* node);
+
+/* Free the tree, including all of its nodes. tree may be NULL. */
+void i3ipc_lazy_free(I3ipc_lazy_tree* tree);
+
+/* Query the tree and expand all of its nodes, but take the nodes whose json has not changed from
+ * prev, a tree from a previous query. This is much faster than i3ipc_get_tree if only a small part
+ * of the tree changed, e.g. a single window. prev may be a lazy tree with only some nodes expanded,
+ * the others are decoded from the new reply. prev may be NULL, it stays valid and has to be freed
+ * separately. You have to free the result with i3ipc_lazy_free, regardless of staticalloc. */
+I3ipc_lazy_tree* i3ipc_get_tree_update(I3ipc_lazy_tree* prev);
+
+/* Return the member name of node, which must be part of tree, as i3 sent it. This works for
+ * members that I3ipc_node does not have, e.g. "sticky" or "scratchpad_state", without parsing the
+ * reply again. If there is no such member, the type of the result is I3IPC_RAW_MISSING. Strings
+ * are allocated with the tree. */
+I3ipc_raw i3ipc_raw_get(I3ipc_lazy_tree* tree, I3ipc_node* node, char const* name);
+
+/* Return the member name of the object raw, see i3ipc_raw_get. If raw has type I3IPC_RAW_MISSING,
+ * so does the result. */
+I3ipc_raw i3ipc_raw_member(I3ipc_raw raw, char const* name);
+
+/* Return the element index of the array raw. If there is no such element, or raw has type
+ * I3IPC_RAW_MISSING, the type of the result is I3IPC_RAW_MISSING. */
+I3ipc_raw i3ipc_raw_index(I3ipc_raw raw, int index);
+
+/* Query the tree, and additionally lay out its nodes as arrays, see I3ipc_flat_tree. Loops over
+ * all nodes are faster that way than walking the tree. You have to free the result with
+ * i3ipc_flat_free, regardless of staticalloc. */
+I3ipc_flat_tree* i3ipc_get_tree_flat(void);
+
+/* Free the flat tree, including all of its nodes. tree may be NULL. */
+void i3ipc_flat_free(I3ipc_flat_tree* tree);
+
 /* Send a tick with the specified payload to subscribers of tick events. */
 void i3ipc_send_tick(char const* payload);
 
@@ -117,6 +166,38 @@ int i3ipc_message_fd(void);
  * but only the last one is valid. See the README for details.*/
 bool i3ipc_set_staticalloc(bool value);
 
+/* Set how many results stay valid with staticalloc, return the old value. Each call returning a
+ * result uses the next one of value buffers, so that the last value results can be used at the
+ * same time. The default of 0 is the same as 1. Changing this invalidates all but the last
+ * result. */
+int i3ipc_set_staticalloc_generations(int value);
+
+/* Set the poison flag, return the old value. If this is set, the buffers of staticalloc results
+ * are overwritten with 0xa5 bytes before they are reused, so that results which are no longer
+ * valid are noticed when they are used. This is meant for debugging. */
+bool i3ipc_set_staticalloc_poison(bool value);
+
+/* Free a result of the functions above, using the allocator set by i3ipc_set_allocator. With the
+ * default allocator, this is the same as free(). reply may be NULL. */
+void i3ipc_free(void* reply);
+
+/* Set whether results are taken from the reply pool, return the old value. Results that you pass to
+ * i3ipc_reply_release go back to the pool, and later results of a similar size reuse them, so that a
+ * program handling events in a loop stops allocating memory. Results taken from the pool must be
+ * freed with i3ipc_reply_release or i3ipc_free, not with free(). Both recognise them even after the
+ * pool was disabled, so this can be changed at any time. Disabling it frees the memory held by the
+ * pool. This has no effect with staticalloc. */
+bool i3ipc_set_reply_pool(bool value);
+
+/* Return a result of the functions above to the reply pool. reply may be NULL. Without the reply
+ * pool, this is the same as i3ipc_free. */
+void i3ipc_reply_release(void* reply);
+
+/* Query how many results were taken from the reply pool (hits) and how many had to be allocated
+ * (misses) since the pool was enabled. out_hits and out_misses are output parameters, they may be
+ * NULL. */
+void i3ipc_reply_pool_counters(uint64_t* out_hits, uint64_t* out_misses);
+
 /* Set the loglevel, return the old value.
  * This controls how much information is printed to the terminal.
  * Values are -1 (silent), 0 (errors, default), 1 (debug messages) */
@@ -196,7 +277,6 @@ typedef struct I3ipc_node_window_properties {
     bool  transient_for_set;
 } I3ipc_node_window_properties;
 
-typedef struct I3ipc_node I3ipc_node;
 struct I3ipc_node {
     size_t id;
     char*  name;
@@ -553,6 +633,51 @@ union I3ipc_event { /*
     I3ipc_event_tick             tick;
 };
 
+enum I3ipc_raw_type {
+    I3IPC_RAW_MISSING = 0,
+    I3IPC_RAW_NULL,
+    I3IPC_RAW_BOOL,
+    I3IPC_RAW_NUMBER,
+    I3IPC_RAW_STRING,
+    I3IPC_RAW_ARRAY,
+    I3IPC_RAW_OBJECT
+};
+
+/* A json value of a lazy tree, see i3ipc_raw_get. Depending on type, flag, number or str is set.
+ * Arrays and objects have size elements or members, use i3ipc_raw_index and i3ipc_raw_member to
+ * access them. */
+struct I3ipc_raw {
+    int    type; /* see I3ipc_raw_type */
+    bool   flag;
+    double number;
+    char*  str;
+    int    str_size;
+    int    size;
+    I3ipc_lazy_tree* tree;
+    int    pos; /* offset of the value in the json of tree */
+};
+
+/* The nodes of a tree in depth-first order, see i3ipc_get_tree_flat. Each node comes before its
+ * children, which are the members nodes and then floating_nodes, and its descendants are the nodes
+ * i+1 up to subtree_end[i]-1. Node i is node[i], the other arrays hold the members that are used
+ * most, so that loops over all nodes do not need to look at the nodes themselves. Indices are -1 if
+ * there is no such node. */
+struct I3ipc_flat_tree {
+    int          size; /* number of nodes, the root is node 0 */
+    I3ipc_node** node;
+    int*         parent;
+    int*         first_child;
+    int*         next_sibling;
+    int*         subtree_end;
+    bool*        floating; /* whether the node is one of the floating_nodes of its parent */
+    size_t*      id;
+    int*         type_enum;
+    int*         window;
+    bool*        focused;
+    I3ipc_rect*  rect;
+    I3ipc_reply_tree* reply; /* holds the nodes */
+};
+
 
 /* *** Error handling *** */
 
@@ -607,7 +732,9 @@ typedef struct __attribute__ ((__packed__)) I3ipc_message {
 int i3ipc_init_try(char* socketpath);
 
 /* Send a message, receive an answer, parse the answer.
- * Same as calling i3ipc_message_try and i3ipc_parse_try in sequence. */
+ * Same as calling i3ipc_message_try and i3ipc_parse_try in sequence, except that the json is
+ * scanned while it arrives. Only the scan overlaps with reading, the whole reply is still buffered
+ * and the structs are filled in after its last byte. */
 int i3ipc_message_and_parse_try(int message, int type, char const* payload, int payload_size, char** out_data);
 
 /* Send a message and receive an answer.
@@ -632,17 +759,101 @@ int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply);
 int i3ipc_message_receive_reorder_try(int message_type, I3ipc_message** out_reply);
 
 /* Parse the json payload of a message.
+ * The payload is modified, unless I3IPC_PARSE_NONDESTRUCTIVE is set.
  * message_type is the expected type of the message, or -1.
  * type_id is the id of the type of the data, see I3ipc_type_values.
  * out_data is an output parameter, it may be NULL. */
 int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** out_data);
 
+/* Determine the number of bytes needed to parse msg with i3ipc_parse_into_try. The arguments are
+ * the same as for i3ipc_parse_try, but msg is not modified.
+ * out_size is an output parameter, it may be NULL. */
+int i3ipc_parse_size_try(I3ipc_message* msg, int message_type, int type_id, size_t* out_size);
+
+/* Parse msg like i3ipc_parse_try, but write the result to the start of buf, which has size bytes.
+ * No memory is allocated for the result, and it does not reference msg. buf must be aligned like memory
+ * from malloc. If it is smaller than what i3ipc_parse_size_try returns, this fails with
+ * I3IPC_ERROR_FAILED. */
+int i3ipc_parse_into_try(I3ipc_message* msg, int message_type, int type_id, char* buf, size_t size);
+
+/* Parse the json payload of a GET_TREE reply lazily, see i3ipc_get_tree_lazy.
+ * The payload is copied, msg is not modified.
+ * out_tree is an output parameter, it may be NULL. */
+int i3ipc_parse_lazy_try(I3ipc_message* msg, I3ipc_lazy_tree** out_tree);
+
+/* Same as i3ipc_lazy_expand. */
+int i3ipc_lazy_expand_try(I3ipc_lazy_tree* tree, I3ipc_node* node);
+
+/* Parse the json payload of a GET_TREE reply, reusing the nodes of prev, see i3ipc_get_tree_update.
+ * The payload is copied, msg is not modified.
+ * out_tree is an output parameter, it may be NULL. */
+int i3ipc_parse_lazy_update_try(I3ipc_message* msg, I3ipc_lazy_tree* prev, I3ipc_lazy_tree** out_tree);
+
+/* Parse the json payload of a GET_TREE reply into a flat tree, see i3ipc_get_tree_flat.
+ * The payload is modified, unless I3IPC_PARSE_NONDESTRUCTIVE is set.
+ * out_tree is an output parameter, it may be NULL. */
+int i3ipc_parse_flat_try(I3ipc_message* msg, I3ipc_flat_tree** out_tree);
+
+/* Same as i3ipc_raw_member and i3ipc_raw_index.
+ * out_raw is an output parameter, it may be NULL. */
+int i3ipc_raw_member_try(I3ipc_raw raw, char const* name, I3ipc_raw* out_raw);
+int i3ipc_raw_index_try(I3ipc_raw raw, int index, I3ipc_raw* out_raw);
+
+/* Set the flags controlling how i3ipc_parse_try works, return the old value.
+ * value is a combination of the I3ipc_parse_flags, the default is 0. Flags only affect performance,
+ * the parsed data is the same (but strings may be shared, see I3IPC_PARSE_INTERN). */
+int i3ipc_set_parseflags(int value);
+
+/* Free the strings interned with I3IPC_PARSE_INTERN_POOL. Results parsed with that flag must not be
+ * used afterwards. */
+void i3ipc_intern_pool_free(void);
+
+/* Set the number of threads used with I3IPC_PARSE_PARALLEL, including the calling one, return the
+ * old value. The default of 0 uses one thread per online processor. */
+int i3ipc_set_parse_threads(int value);
+
+/* Set how deeply json containers may be nested, return the old value. Deeper json is rejected as
+ * malformed, which bounds the stack used by the parser. The default of 0 means
+ * I3IPC_MAX_DEPTH_DEFAULT levels, which is far more than i3 produces. */
+int i3ipc_set_max_depth(int value);
+
+/* Callbacks for the memory the library allocates, see i3ipc_set_allocator. They behave like
+ * malloc, realloc and free, and get user as additional argument. Running out of memory aborts the
+ * program. With I3IPC_PARSE_PARALLEL, they are called from multiple threads at once. */
+typedef struct I3ipc_allocator {
+    void* (*alloc)  (void* user, size_t size);
+    void* (*realloc)(void* user, void* ptr, size_t size);
+    void  (*free)   (void* user, void* ptr);
+    void* user;
+} I3ipc_allocator;
+
+/* Set the allocator used for all memory of the library, including results, return the old one.
+ * allocator may be NULL, which restores the default of malloc, realloc and free. The buffers of the
+ * library and the string pool are released using the old allocator, so results with staticalloc or
+ * I3IPC_PARSE_INTERN_POOL become invalid. Other results have to be freed (with i3ipc_free or
+ * i3ipc_lazy_free) while the allocator that allocated them is set. Queued events are kept. */
+I3ipc_allocator i3ipc_set_allocator(I3ipc_allocator const* allocator);
+
+/* Restrict the members of type_id that are parsed, return the old value. Bit i of mask selects the
+ * i-th member of the type, use i3ipc_projection_mask to compute it. Other members are skipped and
+ * left zeroed, they take up no additional memory. This affects all functions returning data of
+ * that type, e.g. setting a projection for I3IPC_TYPE_NODE affects i3ipc_get_tree. The default
+ * is ~0, i.e. all members are parsed. */
+uint64_t i3ipc_set_projection(int type_id, uint64_t mask);
+
+/* Return the mask selecting the members of type_id named in fields, for i3ipc_set_projection.
+ * fields is a list of json names separated by spaces, e.g. "id name focused nodes". Members like
+ * <name>_size or <name>_enum are set together with <name>. Unknown names cause an error. */
+uint64_t i3ipc_projection_mask(int type_id, char const* fields);
+
 /* Print a json representation of a type to stream f.
  * type_id is the id of the type of the data, see I3ipc_type_values.
  * f may be NULL, in which case stdout will be used. */
 void i3ipc_printjson(int type_id, void* obj, FILE* f);
 
 
+#define I3IPC_MAX_DEPTH_DEFAULT 1024
+
 enum I3ipc_message_type {
     I3IPC_RUN_COMMAND       =  0,
     I3IPC_GET_WORKSPACES    =  1,
@@ -690,6 +901,51 @@ enum I3ipc_event_type {
 };
 
 
+enum I3ipc_parse_flags {
+    /* Scan the json while parsing, instead of storing all tokens first (8 bytes each). This uses
+     * less memory for large messages, but each token is scanned twice. */
+    I3IPC_PARSE_STREAM = 1,
+    
+    /* Parse in a single pass, allocating from a chunked arena, instead of determining the sizes of
+     * everything first. Arrays are grown as they are parsed, so this needs more (temporary) memory.
+     * Without staticalloc, the result is compacted into a single block at the end, so that it can
+     * still be freed with i3ipc_free. */
+    I3IPC_PARSE_SINGLEPASS = 2,
+
+    /* Parse large GET_TREE replies on multiple threads, see i3ipc_set_parse_threads. The children of
+     * the root, and of the largest nodes below it (usually the outputs), are parsed independently
+     * on worker threads, the rest of the tree is then parsed as with I3IPC_PARSE_SINGLEPASS. This
+     * needs I3IPC_THREADS to be enabled, otherwise it is the same as I3IPC_PARSE_SINGLEPASS.
+     * Ignored together with I3IPC_PARSE_STREAM. */
+    I3IPC_PARSE_PARALLEL = 4,
+
+    /* Strings that are equal share a single copy in the result. The same few strings (e.g. the
+     * type, layout and border of nodes, or window classes) appear all over a tree, so this makes
+     * the result smaller and saves copying. Has no effect with staticalloc, where strings are not
+     * copied, or with I3IPC_PARSE_STREAM without I3IPC_PARSE_SINGLEPASS, unless
+     * I3IPC_PARSE_NONDESTRUCTIVE is set. */
+    I3IPC_PARSE_INTERN = 8,
+
+    /* Like I3IPC_PARSE_INTERN, but short strings are shared with all results parsed before, using
+     * a pool that lives across parses. Results then point into the pool, so they must not be used
+     * after calling i3ipc_intern_pool_free. This helps if a long-running program keeps many
+     * results around. The pool only grows, so you should free it from time to time. */
+    I3IPC_PARSE_INTERN_POOL = 16,
+
+    /* Do not copy strings one by one, instead put a copy of the whole json behind the result, in
+     * the same block, and let the strings point into it. This is almost as fast as staticalloc,
+     * but the result stays valid until you free it with i3ipc_free. It is larger, as it contains
+     * all of the json. Has no effect with staticalloc. */
+    I3IPC_PARSE_ZEROCOPY = 32,
+
+    /* Leave the message as it is. Usually, strings are decoded in place inside the payload, which
+     * is then unusable, and msg->message_length is set to 0. With this flag, strings are decoded
+     * directly into the result instead, so that the same message can be parsed again (e.g. with
+     * different projections) or passed on. Strings are then copied even with staticalloc, into
+     * the memory of the result. I3IPC_PARSE_ZEROCOPY has no effect together with this flag. */
+    I3IPC_PARSE_NONDESTRUCTIVE = 64
+};
+
 enum I3ipc_type_values {
     /* Primitive types */
     I3IPC_TYPE_BOOL,       /* bool */
@@ -752,6 +1008,7 @@ enum I3ipc_type_values {
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <locale.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -783,6 +1040,37 @@ template<typename Type> struct I3ipc__align { char c; Type t; };
 #endif /* I3IPC_ANONYMOUS_UNION */
 
 
+#ifndef I3IPC_SIMD
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define I3IPC_SIMD 1
+#else
+#define I3IPC_SIMD 0
+#endif
+
+#endif /* I3IPC_SIMD */
+
+#if I3IPC_SIMD
+#include <immintrin.h>
+#endif
+
+
+/* Whether I3IPC_PARSE_PARALLEL may use threads. You need to link with -pthread if this is set. */
+#ifndef I3IPC_THREADS
+#define I3IPC_THREADS 0
+#endif /* I3IPC_THREADS */
+
+#if I3IPC_THREADS
+#include <pthread.h>
+#endif
+
+/* Whether to parse with the straight-line parsers generated by misc/gen-parsers.py, instead of
+ * interpreting i3ipc__global_fields */
+#ifndef I3IPC_GENERATED_PARSERS
+#define I3IPC_GENERATED_PARSERS 1
+#endif /* I3IPC_GENERATED_PARSERS */
+
+
 
 static bool i3ipc__globals_initialized;
 static FILE* i3ipc__err;
@@ -803,9 +1091,84 @@ enum I3ipc_context_buffers {
     I3IPC_CONTEXT_REORDER,
     I3IPC_CONTEXT_JSON,
     I3IPC_CONTEXT_PAYLOAD,
+    I3IPC_CONTEXT_PARALLEL,
     I3IPC_CONTEXT_BUFFER_SIZE
 };
 
+/* Memory is allocated from the first chunk, older chunks are in the list behind it. Chunks are
+ * never moved, so pointers into them stay valid until the arena is reset. */
+typedef struct I3ipc_arena_chunk {
+    struct I3ipc_arena_chunk* next;
+    size_t size;
+} I3ipc_arena_chunk;
+
+typedef struct I3ipc_arena {
+    I3ipc_arena_chunk* chunks;
+    char* cur;
+    size_t left;
+    size_t total_size;
+} I3ipc_arena;
+
+/* Hash table of strings, see I3IPC_PARSE_INTERN. Uses linear probing, the capacity is a power of
+ * two. */
+typedef struct I3ipc_intern_entry {
+    char const* str; /* the first occurrence, NULL if the entry is empty */
+    int str_size;
+    uint64_t hash;
+    char* copy;  /* the copy in the result, or in the pool */
+    char* moved; /* where copy was moved to during compaction */
+} I3ipc_intern_entry;
+
+typedef struct I3ipc_intern {
+    I3ipc_intern_entry* entries;
+    int size;
+    int capacity;
+    I3ipc_arena arena; /* only for the pool, holds the copies */
+} I3ipc_intern;
+
+/* With the reply pool, results are preceded by this header. Blocks have a size of 1 << size_class
+ * bytes, including the header, and the pool keeps a list of free blocks for each size class. */
+typedef struct I3ipc_reply_block {
+    struct I3ipc_reply_block* next; /* only used while the block is in the pool */
+    int size_class;
+    uint32_t magic; /* I3IPC__REPLY_MAGIC */
+} I3ipc_reply_block;
+
+#define I3IPC__REPLY_HEADER 16
+#define I3IPC__REPLY_MAGIC 0x72706c79u
+#define I3IPC__REPLY_CLASS_MIN 6
+#define I3IPC__REPLY_CLASSES 40
+/* At most this many free blocks are kept for each size class, further ones are freed */
+#define I3IPC__REPLY_POOL_MAX 8
+
+typedef struct I3ipc_reply_pool {
+    I3ipc_reply_block* blocks[I3IPC__REPLY_CLASSES];
+    int blocks_size[I3IPC__REPLY_CLASSES];
+    uint64_t hits;
+    uint64_t misses;
+} I3ipc_reply_pool;
+
+/* The results that were taken from the reply pool and have not been freed, so that i3ipc_free can
+ * tell them apart from other results without looking in front of them. Hash set of pointers, uses
+ * linear probing, the capacity is a power of two. */
+typedef struct I3ipc_reply_live {
+    char** entries;
+    int size;
+    int capacity;
+} I3ipc_reply_live;
+
+/* The memory a staticalloc result may reference, see i3ipc_set_staticalloc_generations. The
+ * current generation is kept in the context itself, the others here. */
+typedef struct I3ipc_generation {
+    char* msg;
+    size_t msg_size;
+    char* parse;
+    size_t parse_size;
+    I3ipc_arena arena;
+    I3ipc_arena* parallel_arenas;
+    int parallel_arenas_size;
+} I3ipc_generation;
+
 typedef struct I3ipc_context {
     int state;
     int sock;
@@ -813,10 +1176,30 @@ typedef struct I3ipc_context {
 
     char* buffers[I3IPC_CONTEXT_BUFFER_SIZE];
     size_t buffer_sizes[I3IPC_CONTEXT_BUFFER_SIZE];
+    I3ipc_arena arena;
     
     bool nopanic;
     bool staticalloc;
+    int parseflags;
+    uint64_t projection_skip[I3IPC_TYPE_COUNT]; /* inverse of the mask, so that zero is the default */
+    I3ipc_intern intern;
+    I3ipc_intern intern_pool;
+    int parse_threads;
+    int max_depth;
+    I3ipc_allocator allocator; /* zero means malloc, realloc and free */
+    I3ipc_arena* parallel_arenas; /* one for each thread of i3ipc__parallel_parse */
+    int parallel_arenas_size;
+    I3ipc_generation* generations; /* ring of staticalloc_generations, allocated when needed */
+    int staticalloc_generations;
+    int generation; /* index of the current generation in the ring */
+    bool generation_used; /* whether a result references the current generation */
+    bool staticalloc_poison;
+    bool reply_pool_flag;
+    I3ipc_reply_pool reply_pool;
+    I3ipc_reply_live reply_live;
     bool debug_do_not_write_messages;
+    bool debug_parallel_always; /* also split messages that are too small to benefit */
+    bool debug_interpret; /* do not use the generated parsers or i3ipc__parse_success */
     bool debug_nodata_is_error;
     int loglevel;
 
@@ -901,6 +1284,44 @@ bool i3ipc_set_staticalloc(bool value) {
     return prev;
 }
 
+bool i3ipc_set_staticalloc_poison(bool value) {
+    I3ipc_context* context = &i3ipc__global_context;
+    bool prev = context->staticalloc_poison;
+    context->staticalloc_poison = value;
+    return prev;
+}
+
+int i3ipc_set_parseflags(int value) {
+    I3ipc_context* context = &i3ipc__global_context;
+    int prev = context->parseflags;
+    context->parseflags = value;
+    return prev;
+}
+
+int i3ipc_set_parse_threads(int value) {
+    assert(value >= 0);
+    I3ipc_context* context = &i3ipc__global_context;
+    int prev = context->parse_threads;
+    context->parse_threads = value;
+    return prev;
+}
+
+int i3ipc_set_max_depth(int value) {
+    assert(value >= 0);
+    I3ipc_context* context = &i3ipc__global_context;
+    int prev = context->max_depth;
+    context->max_depth = value;
+    return prev;
+}
+
+uint64_t i3ipc_set_projection(int type_id, uint64_t mask) {
+    assert(0 <= type_id && type_id < I3IPC_TYPE_COUNT);
+    I3ipc_context* context = &i3ipc__global_context;
+    uint64_t prev = ~context->projection_skip[type_id];
+    context->projection_skip[type_id] = ~mask;
+    return prev;
+}
+
 int i3ipc_set_loglevel(int value) {
     I3ipc_context* context = &i3ipc__global_context;
     int prev = context->loglevel;
@@ -924,6 +1345,38 @@ bool i3ipc_set_nopanic(bool value) {
     return prev;
 }
 
+/* Allocate memory using the allocator of the context. These never return NULL. */
+void* i3ipc__realloc(void* ptr, size_t size) {
+    I3ipc_allocator* allocator = &i3ipc__global_context.allocator;
+    if (allocator->alloc) {
+        ptr = ptr ? allocator->realloc(allocator->user, ptr, size) : allocator->alloc(allocator->user, size);
+    } else {
+        ptr = realloc(ptr, size);
+    }
+    if (!ptr && size) {
+        fprintf(stderr, "Error: i3ipc: out of memory\n");
+        abort();
+    }
+    return ptr;
+}
+void* i3ipc__malloc(size_t size) {
+    return i3ipc__realloc(NULL, size);
+}
+void* i3ipc__calloc(size_t count, size_t size) {
+    void* ptr = i3ipc__realloc(NULL, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+void i3ipc__free(void* ptr) {
+    I3ipc_allocator* allocator = &i3ipc__global_context.allocator;
+    if (!ptr) return;
+    if (allocator->free) {
+        allocator->free(allocator->user, ptr);
+    } else {
+        free(ptr);
+    }
+}
+
 int i3ipc_message_fd(void) {
     I3ipc_context* context = &i3ipc__global_context;
     return context->sock;
@@ -969,7 +1422,7 @@ int i3ipc__socketpath_cmd_try(char** out_path) {
         if (buf_size - off < space_min) {
             buf_size *= 2;
             if (buf_size - off < space_min) buf_size = off + space_min;
-            buf = (char*)realloc(buf, buf_size);
+            buf = (char*)i3ipc__realloc(buf, buf_size);
         }
         
         ssize_t bytes_read = read(pipefd[0], buf+off, buf_size-off);
@@ -1007,7 +1460,7 @@ int i3ipc__socketpath_cmd_try(char** out_path) {
     return 0;
 
   cleanup:
-    free(buf);
+    i3ipc__free(buf);
     return rcode;
 }
 
@@ -1060,7 +1513,7 @@ int i3ipc__socket_open_try(char* socketpath, int* out_sock, char** out_socketpat
     rcode = 0;
 
   cleanup:
-    free(socketpath_to_free);
+    i3ipc__free(socketpath_to_free);
   done:
     return rcode;
 }
@@ -1129,12 +1582,12 @@ int i3ipc_init_try(char* socketpath) {
     {int code = i3ipc__socket_open_try(socketpath, &context->sock_events, NULL);
     if (code) goto error_free;}
     
-    free(socketpath_to_free);
+    i3ipc__free(socketpath_to_free);
     context->state = I3IPC_STATE_READY;
     return 0;
 
   error_free:
-    free(socketpath_to_free);
+    i3ipc__free(socketpath_to_free);
     context->state = I3IPC_ERROR_CLOSED;
     return I3IPC_ERROR_CLOSED;
 }
@@ -1208,11 +1661,433 @@ void i3ipc__context_reserve(I3ipc_context* context, int buf_id, size_t size_next
         if (*buf_size < size_next) {
             *buf_size = size_next;
         }
-        *buf = (char*)realloc(*buf, *buf_size);
+        *buf = (char*)i3ipc__realloc(*buf, *buf_size);
     }
     if (out_ptr) *out_ptr = *buf;
 }
 
+/* The data of a chunk starts after the header, at this alignment */
+#define I3IPC__ARENA_ALIGN 16
+#define I3IPC__ARENA_HEADER ((sizeof(I3ipc_arena_chunk) + I3IPC__ARENA_ALIGN-1) & ~(I3IPC__ARENA_ALIGN-1))
+
+void i3ipc__arena_push_chunk(I3ipc_arena* arena, size_t size) {
+    I3ipc_arena_chunk* chunk = (I3ipc_arena_chunk*)i3ipc__malloc(I3IPC__ARENA_HEADER + size);
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    arena->chunks = chunk;
+    arena->cur = (char*)chunk + I3IPC__ARENA_HEADER;
+    arena->left = size;
+    arena->total_size += size;
+}
+
+/* Return size bytes of zeroed memory with the given alignment (at most I3IPC__ARENA_ALIGN). */
+char* i3ipc__arena_alloc(I3ipc_arena* arena, size_t size, size_t alignment) {
+    assert(alignment && alignment <= I3IPC__ARENA_ALIGN);
+    size_t pad = -(size_t)arena->cur & (alignment-1);
+    if (!arena->chunks || arena->left < pad + size) {
+        size_t chunk_size = arena->chunks ? 2 * arena->chunks->size : 4096;
+        while (chunk_size < size) chunk_size *= 2;
+        i3ipc__arena_push_chunk(arena, chunk_size);
+        pad = 0;
+    }
+    char* result = arena->cur + pad;
+    arena->cur  += pad + size;
+    arena->left -= pad + size;
+    memset(result, 0, size);
+    return result;
+}
+
+/* Shrink the allocation at ptr from size to size_next bytes. This only frees memory if it was the
+ * last allocation. */
+void i3ipc__arena_shrink(I3ipc_arena* arena, char* ptr, size_t size, size_t size_next) {
+    assert(size_next <= size);
+    if (ptr && ptr + size == arena->cur) {
+        arena->cur  -= size - size_next;
+        arena->left += size - size_next;
+    }
+}
+
+/* Make all memory of the arena available again. If more than one chunk was needed, they are merged
+ * into a single one, so that the next time everything fits. */
+void i3ipc__arena_reset(I3ipc_arena* arena) {
+    if (arena->chunks && arena->chunks->next) {
+        size_t total_size = arena->total_size;
+        while (arena->chunks) {
+            I3ipc_arena_chunk* next = arena->chunks->next;
+            i3ipc__free(arena->chunks);
+            arena->chunks = next;
+        }
+        arena->total_size = 0;
+        i3ipc__arena_push_chunk(arena, total_size);
+    } else if (arena->chunks) {
+        arena->cur = (char*)arena->chunks + I3IPC__ARENA_HEADER;
+        arena->left = arena->chunks->size;
+    }
+}
+
+/* Free all memory of the arena */
+void i3ipc__arena_free(I3ipc_arena* arena) {
+    while (arena->chunks) {
+        I3ipc_arena_chunk* next = arena->chunks->next;
+        i3ipc__free(arena->chunks);
+        arena->chunks = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+uint64_t i3ipc__hash_string(char const* str, int size) {
+    uint64_t h = (uint64_t)size * UINT64_C(0x9e3779b97f4a7c15);
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t x;
+        memcpy(&x, str + i, 8);
+        h = (h ^ x) * UINT64_C(0xbf58476d1ce4e5b9);
+        h ^= h >> 31;
+    }
+    uint64_t x = 0;
+    memcpy(&x, str + i, size - i);
+    h = (h ^ x) * UINT64_C(0x94d049bb133111eb);
+    return h ^ (h >> 29);
+}
+
+/* Return the entry of the string str, which has str_size bytes. If there is none, return NULL, or
+ * insert a new one if insert is set. *out_new is set to whether that happened, it may be NULL. */
+I3ipc_intern_entry* i3ipc__intern_find(I3ipc_intern* table, char const* str, int str_size, bool insert, bool* out_new) {
+    if (out_new) *out_new = false;
+    if (insert && 2 * (table->size + 1) > table->capacity) {
+        I3ipc_intern_entry* entries = table->entries;
+        int capacity = table->capacity;
+        table->capacity = capacity ? 2 * capacity : 256;
+        table->entries = (I3ipc_intern_entry*)i3ipc__calloc(table->capacity, sizeof(table->entries[0]));
+        
+        size_t mask = table->capacity - 1;
+        for (int i = 0; i < capacity; ++i) {
+            if (!entries[i].str) continue;
+            size_t j = entries[i].hash & mask;
+            while (table->entries[j].str) j = (j + 1) & mask;
+            table->entries[j] = entries[i];
+        }
+        i3ipc__free(entries);
+    }
+    if (!table->capacity) return NULL;
+    
+    uint64_t hash = i3ipc__hash_string(str, str_size);
+    size_t mask = table->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        I3ipc_intern_entry* entry = &table->entries[i];
+        if (!entry->str) {
+            if (!insert) return NULL;
+            entry->str = str;
+            entry->str_size = str_size;
+            entry->hash = hash;
+            ++table->size;
+            if (out_new) *out_new = true;
+            return entry;
+        }
+        if (entry->hash == hash && entry->str_size == str_size && memcmp(entry->str, str, str_size) == 0) {
+            return entry;
+        }
+    }
+}
+
+/* Remove all entries */
+void i3ipc__intern_reset(I3ipc_intern* table) {
+    if (table->size) memset(table->entries, 0, table->capacity * sizeof(table->entries[0]));
+    table->size = 0;
+    i3ipc__arena_reset(&table->arena);
+}
+
+void i3ipc__intern_free(I3ipc_intern* table) {
+    i3ipc__free(table->entries);
+    i3ipc__arena_free(&table->arena);
+    memset(table, 0, sizeof(*table));
+}
+
+void i3ipc_intern_pool_free(void) {
+    i3ipc__intern_free(&i3ipc__global_context.intern_pool);
+}
+
+/* Free the blocks in the reply pool */
+void i3ipc__reply_pool_free(I3ipc_reply_pool* pool) {
+    for (int i = 0; i < I3IPC__REPLY_CLASSES; ++i) {
+        while (pool->blocks[i]) {
+            I3ipc_reply_block* next = pool->blocks[i]->next;
+            i3ipc__free(pool->blocks[i]);
+            pool->blocks[i] = next;
+        }
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+size_t i3ipc__reply_live_slot(I3ipc_reply_live* live, char* reply) {
+    uint64_t h = (uint64_t)(uintptr_t)reply * UINT64_C(0x9e3779b97f4a7c15);
+    return (size_t)(h >> 32) & (live->capacity - 1);
+}
+
+void i3ipc__reply_live_insert(I3ipc_reply_live* live, char* reply) {
+    if (2 * (live->size + 1) > live->capacity) {
+        char** entries = live->entries;
+        int capacity = live->capacity;
+        live->capacity = capacity ? 2 * capacity : 64;
+        live->entries = (char**)i3ipc__calloc(live->capacity, sizeof(live->entries[0]));
+        for (int i = 0; i < capacity; ++i) {
+            if (!entries[i]) continue;
+            size_t j = i3ipc__reply_live_slot(live, entries[i]);
+            while (live->entries[j]) j = (j + 1) & (live->capacity - 1);
+            live->entries[j] = entries[i];
+        }
+        i3ipc__free(entries);
+    }
+    size_t i = i3ipc__reply_live_slot(live, reply);
+    while (live->entries[i]) i = (i + 1) & (live->capacity - 1);
+    live->entries[i] = reply;
+    ++live->size;
+}
+
+/* Remove reply from the set, return whether it was there */
+bool i3ipc__reply_live_remove(I3ipc_reply_live* live, char* reply) {
+    if (!live->size) return false;
+    size_t mask = live->capacity - 1;
+    size_t i = i3ipc__reply_live_slot(live, reply);
+    while (live->entries[i] != reply) {
+        if (!live->entries[i]) return false;
+        i = (i + 1) & mask;
+    }
+
+    /* Move later entries back into the gap, unless that is before their slot */
+    for (size_t j = (i + 1) & mask; live->entries[j]; j = (j + 1) & mask) {
+        size_t k = i3ipc__reply_live_slot(live, live->entries[j]);
+        if (((j - k) & mask) >= ((j - i) & mask)) {
+            live->entries[i] = live->entries[j];
+            i = j;
+        }
+    }
+    live->entries[i] = NULL;
+    --live->size;
+    return true;
+}
+
+/* Allocate memory for a result of size bytes, which is not initialised. Unless staticalloc is set,
+ * the result is freed with i3ipc_free. */
+char* i3ipc__reply_alloc(I3ipc_context* context, size_t size) {
+    if (!context->reply_pool_flag) return (char*)i3ipc__malloc(size);
+
+    int size_class = I3IPC__REPLY_CLASS_MIN;
+    while (((size_t)1 << size_class) < size + I3IPC__REPLY_HEADER) ++size_class;
+    assert(size_class < I3IPC__REPLY_CLASSES);
+
+    I3ipc_reply_pool* pool = &context->reply_pool;
+    I3ipc_reply_block* block = pool->blocks[size_class];
+    if (block) {
+        pool->blocks[size_class] = block->next;
+        --pool->blocks_size[size_class];
+        ++pool->hits;
+    } else {
+        block = (I3ipc_reply_block*)i3ipc__malloc((size_t)1 << size_class);
+        block->size_class = size_class;
+        block->magic = I3IPC__REPLY_MAGIC;
+        ++pool->misses;
+    }
+    block->next = NULL;
+    char* reply = (char*)block + I3IPC__REPLY_HEADER;
+    i3ipc__reply_live_insert(&context->reply_live, reply);
+    return reply;
+}
+
+/* If reply was taken from the reply pool, return its block, else NULL. In both cases, the caller
+ * owns the memory afterwards. */
+I3ipc_reply_block* i3ipc__reply_block(I3ipc_context* context, void* reply) {
+    if (!reply || !i3ipc__reply_live_remove(&context->reply_live, (char*)reply)) return NULL;
+    I3ipc_reply_block* block = (I3ipc_reply_block*)((char*)reply - I3IPC__REPLY_HEADER);
+    assert(block->magic == I3IPC__REPLY_MAGIC);
+    assert(I3IPC__REPLY_CLASS_MIN <= block->size_class && block->size_class < I3IPC__REPLY_CLASSES);
+    return block;
+}
+
+void i3ipc_free(void* reply) {
+    I3ipc_context* context = &i3ipc__global_context;
+    I3ipc_reply_block* block = i3ipc__reply_block(context, reply);
+    i3ipc__free(block ? (void*)block : reply);
+}
+
+bool i3ipc_set_reply_pool(bool value) {
+    I3ipc_context* context = &i3ipc__global_context;
+    bool prev = context->reply_pool_flag;
+    context->reply_pool_flag = value;
+    if (!value) i3ipc__reply_pool_free(&context->reply_pool);
+    return prev;
+}
+
+void i3ipc_reply_release(void* reply) {
+    I3ipc_context* context = &i3ipc__global_context;
+    I3ipc_reply_block* block = i3ipc__reply_block(context, reply);
+    if (!block) {
+        i3ipc__free(reply);
+        return;
+    }
+
+    I3ipc_reply_pool* pool = &context->reply_pool;
+    int size_class = block->size_class;
+    if (!context->reply_pool_flag || pool->blocks_size[size_class] >= I3IPC__REPLY_POOL_MAX) {
+        i3ipc__free(block);
+        return;
+    }
+    block->next = pool->blocks[size_class];
+    pool->blocks[size_class] = block;
+    ++pool->blocks_size[size_class];
+}
+
+void i3ipc_reply_pool_counters(uint64_t* out_hits, uint64_t* out_misses) {
+    I3ipc_context* context = &i3ipc__global_context;
+    if (out_hits) *out_hits = context->reply_pool.hits;
+    if (out_misses) *out_misses = context->reply_pool.misses;
+}
+
+/* Exchange the current generation of the context with gen */
+void i3ipc__generation_swap(I3ipc_context* context, I3ipc_generation* gen) {
+    I3ipc_generation cur;
+    cur.msg = context->buffers[I3IPC_CONTEXT_MSG];
+    cur.msg_size = context->buffer_sizes[I3IPC_CONTEXT_MSG];
+    cur.parse = context->buffers[I3IPC_CONTEXT_PARSE];
+    cur.parse_size = context->buffer_sizes[I3IPC_CONTEXT_PARSE];
+    cur.arena = context->arena;
+    cur.parallel_arenas = context->parallel_arenas;
+    cur.parallel_arenas_size = context->parallel_arenas_size;
+
+    context->buffers[I3IPC_CONTEXT_MSG] = gen->msg;
+    context->buffer_sizes[I3IPC_CONTEXT_MSG] = gen->msg_size;
+    context->buffers[I3IPC_CONTEXT_PARSE] = gen->parse;
+    context->buffer_sizes[I3IPC_CONTEXT_PARSE] = gen->parse_size;
+    context->arena = gen->arena;
+    context->parallel_arenas = gen->parallel_arenas;
+    context->parallel_arenas_size = gen->parallel_arenas_size;
+    *gen = cur;
+}
+
+void i3ipc__arena_poison(I3ipc_arena* arena) {
+    for (I3ipc_arena_chunk* chunk = arena->chunks; chunk; chunk = chunk->next) {
+        memset((char*)chunk + I3IPC__ARENA_HEADER, 0xa5, chunk->size);
+    }
+}
+
+/* Free the generations other than the current one */
+void i3ipc__generations_free(I3ipc_context* context) {
+    if (!context->generations) return;
+    int size = context->staticalloc_generations;
+    for (int i = 0; i < size; ++i) {
+        if (i == context->generation) continue;
+        I3ipc_generation* gen = &context->generations[i];
+        i3ipc__free(gen->msg);
+        i3ipc__free(gen->parse);
+        i3ipc__arena_free(&gen->arena);
+        for (int j = 0; j < gen->parallel_arenas_size; ++j) {
+            i3ipc__arena_free(&gen->parallel_arenas[j]);
+        }
+        i3ipc__free(gen->parallel_arenas);
+    }
+    i3ipc__free(context->generations);
+    context->generations = NULL;
+    context->generation = 0;
+}
+
+/* Called before the memory of the current generation is written. If a result references it, move
+ * on to the next generation, which is then reused. keep may point to a message that is still
+ * needed, it is not poisoned. */
+void i3ipc__generation_next(I3ipc_context* context, I3ipc_message* keep) {
+    if (!context->generation_used) return;
+    context->generation_used = false;
+
+    int size = context->staticalloc_generations;
+    if (size > 1) {
+        if (!context->generations) {
+            context->generations = (I3ipc_generation*)i3ipc__calloc(size, sizeof(I3ipc_generation));
+            context->generation = 0;
+        }
+        i3ipc__generation_swap(context, &context->generations[context->generation]);
+        context->generation = (context->generation + 1) % size;
+        i3ipc__generation_swap(context, &context->generations[context->generation]);
+    }
+    
+    if (context->staticalloc_poison) {
+        if (context->buffers[I3IPC_CONTEXT_MSG] && context->buffers[I3IPC_CONTEXT_MSG] != (char*)keep) {
+            memset(context->buffers[I3IPC_CONTEXT_MSG], 0xa5, context->buffer_sizes[I3IPC_CONTEXT_MSG]);
+        }
+        if (context->buffers[I3IPC_CONTEXT_PARSE]) {
+            memset(context->buffers[I3IPC_CONTEXT_PARSE], 0xa5, context->buffer_sizes[I3IPC_CONTEXT_PARSE]);
+        }
+        i3ipc__arena_poison(&context->arena);
+        for (int i = 0; i < context->parallel_arenas_size; ++i) {
+            i3ipc__arena_poison(&context->parallel_arenas[i]);
+        }
+    }
+}
+
+int i3ipc_set_staticalloc_generations(int value) {
+    assert(value >= 0);
+    I3ipc_context* context = &i3ipc__global_context;
+    int prev = context->staticalloc_generations;
+    i3ipc__generations_free(context);
+    context->staticalloc_generations = value;
+    return prev;
+}
+
+I3ipc_allocator i3ipc_set_allocator(I3ipc_allocator const* allocator) {
+    assert(!allocator || (allocator->alloc && allocator->realloc && allocator->free));
+    I3ipc_context* context = &i3ipc__global_context;
+    I3ipc_allocator prev = context->allocator;
+    I3ipc_allocator next;
+    if (allocator) {
+        next = *allocator;
+    } else {
+        memset(&next, 0, sizeof(next));
+    }
+
+    /* Move the queued events over to the new allocator */
+    I3ipc_message** queued = (I3ipc_message**)context->buffers[I3IPC_CONTEXT_REORDER];
+    I3ipc_message** queued_next = NULL;
+    if (context->events_queued) {
+        context->allocator = next;
+        queued_next = (I3ipc_message**)i3ipc__malloc(context->events_queued * sizeof(queued[0]));
+        for (int i = 0; i < context->events_queued; ++i) {
+            size_t size = sizeof(*queued[i]) + queued[i]->message_length;
+            queued_next[i] = (I3ipc_message*)i3ipc__malloc(size);
+            memcpy(queued_next[i], queued[i], size);
+        }
+        context->allocator = prev;
+        for (int i = 0; i < context->events_queued; ++i) {
+            i3ipc__free(queued[i]);
+        }
+    }
+
+    /* Everything else is allocated again when it is needed */
+    i3ipc__generations_free(context);
+    i3ipc__reply_pool_free(&context->reply_pool);
+    assert(!context->reply_live.size); /* results from the pool have to be freed before */
+    i3ipc__free(context->reply_live.entries);
+    memset(&context->reply_live, 0, sizeof(context->reply_live));
+    for (int i = 0; i < I3IPC_CONTEXT_BUFFER_SIZE; ++i) {
+        i3ipc__free(context->buffers[i]);
+        context->buffers[i] = NULL;
+        context->buffer_sizes[i] = 0;
+    }
+    i3ipc__arena_free(&context->arena);
+    i3ipc__intern_free(&context->intern);
+    i3ipc__intern_free(&context->intern_pool);
+    for (int i = 0; i < context->parallel_arenas_size; ++i) {
+        i3ipc__arena_free(&context->parallel_arenas[i]);
+    }
+    i3ipc__free(context->parallel_arenas);
+    context->parallel_arenas = NULL;
+    context->parallel_arenas_size = 0;
+
+    context->allocator = next;
+    if (queued_next) {
+        context->buffers[I3IPC_CONTEXT_REORDER] = (char*)queued_next;
+        context->buffer_sizes[I3IPC_CONTEXT_REORDER] = context->events_queued * sizeof(queued[0]);
+    }
+    return prev;
+}
+
 int i3ipc__message_type_to_socket(I3ipc_context* context, int message_type) {
     if (message_type == I3IPC_SUBSCRIBE) {
         return context->sock_events;
@@ -1257,6 +2132,7 @@ int i3ipc_message_send_try(int message_type, char const* payload, int payload_si
     int sock = i3ipc__message_type_to_socket(context, message_type);
 
     I3ipc_message* msg;
+    i3ipc__generation_next(context, NULL);
     i3ipc__context_reserve(context, I3IPC_CONTEXT_MSG,
         sizeof(I3ipc_message) + payload_size, (void**)&msg);
 
@@ -1302,8 +2178,46 @@ int i3ipc_message_send_try(int message_type, char const* payload, int payload_si
     return 0;
 }
 
+/* These are defined with the json lexer below */
+struct I3ipc_json_state;
+bool i3ipc__json_scan_begin(I3ipc_context* context, struct I3ipc_json_state* state, char* json, int json_size);
+int i3ipc__json_scan_feed(I3ipc_context* context, struct I3ipc_json_state* state, int json_size, bool final);
+
+/* Like i3ipc__read_all_try, but feed the payload to the tape scanner of state as it arrives. If the
+ * json cannot be scanned, scanning stops but reading continues, so that the socket stays in sync.
+ * The parser then scans again and reports the error. */
+int i3ipc__read_all_scan_try(I3ipc_context* context, int fd, char* buf, int buf_size, struct I3ipc_json_state* scan) {
+    bool scanning = i3ipc__json_scan_begin(context, scan, buf, buf_size);
+    int size = 0;
+    while (size < buf_size) {
+        ssize_t bytes_read = read(fd, buf + size, buf_size - size);
+        if (bytes_read == -1) {
+            bool wouldblock = errno == EWOULDBLOCK || errno == EAGAIN;
+            i3ipc__error_errno("while calling read()");
+            return wouldblock ? I3IPC_READ_ALL_WOULDBLOCK : I3IPC_READ_ALL_ERROR;
+        }
+        if (bytes_read == 0) {
+            fprintf(i3ipc__err, "unexpected eof (%ld bytes left to read)\n", (long)(buf_size - size));
+            return I3IPC_READ_ALL_EOF;
+        }
+        size += bytes_read;
+        
+        if (scanning && size < buf_size && i3ipc__json_scan_feed(context, scan, size, false)) {
+            i3ipc__error_clearbuf();
+            scanning = false;
+        }
+    }
+    
+    if (scanning && i3ipc__json_scan_feed(context, scan, buf_size, true)) {
+        i3ipc__error_clearbuf();
+    }
+    return 0;
+}
 
-int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply) {
+/* Receive a message, see i3ipc_message_receive_try . If scan is not NULL, the payload is scanned
+ * onto the tape while it is being read, see i3ipc__parse_try . The payload is buffered completely
+ * either way (up to size_max), as the tape refers to the strings in it. */
+int i3ipc__message_receive_try(int message_type, I3ipc_message** out_reply, struct I3ipc_json_state* scan) {
     I3ipc_context* context = &i3ipc__global_context;
     {int code = i3ipc_init_try(NULL);
     if (code) return code;}
@@ -1311,6 +2225,7 @@ int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply) {
     int sock = i3ipc__message_type_to_socket(context, message_type);
     
     I3ipc_message* msg;
+    i3ipc__generation_next(context, NULL);
     i3ipc__context_reserve(context, I3IPC_CONTEXT_MSG, sizeof(*msg), (void**)&msg);
 
     {int code = i3ipc__read_all_try(sock, (char*)msg, sizeof(*msg));
@@ -1333,7 +2248,11 @@ int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply) {
         }
         i3ipc__context_reserve(context, I3IPC_CONTEXT_MSG, size, (void**)&msg);
         
-        code = i3ipc__read_all_try(sock, (char*)(msg + 1), msg->message_length);
+        if (scan) {
+            code = i3ipc__read_all_scan_try(context, sock, (char*)(msg + 1), msg->message_length, scan);
+        } else {
+            code = i3ipc__read_all_try(sock, (char*)(msg + 1), msg->message_length);
+        }
     }
     
     if (code == I3IPC_READ_ALL_EOF) {
@@ -1386,6 +2305,10 @@ int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply) {
     return 0;
 }
 
+int i3ipc_message_receive_try(int message_type, I3ipc_message** out_reply) {
+    return i3ipc__message_receive_try(message_type, out_reply, NULL);
+}
+
 int i3ipc_message_try(int message_type, char const* payload, int payload_size, I3ipc_message** out_reply) {
     {int code = i3ipc_message_send_try(message_type, payload, payload_size);
     if (code) return code;}
@@ -1410,10 +2333,11 @@ int i3ipc_message_receive_reorder_try(int message_type, I3ipc_message** out_repl
             if (message_type == I3IPC_EVENT_ANY || buf[i]->message_type == message_type) {
                 I3ipc_message* msg;
                 size_t size = sizeof(*msg) + buf[i]->message_length;
+                i3ipc__generation_next(context, NULL);
                 i3ipc__context_reserve(context, I3IPC_CONTEXT_MSG, size, (void**)&msg);
                 memcpy(msg, buf[i], size);
                 
-                free(buf[i]);
+                i3ipc__free(buf[i]);
                 for (int j = i; j+1 < context->events_queued; ++j) {
                     buf[j] = buf[j+1];
                 }
@@ -1438,7 +2362,7 @@ int i3ipc_message_receive_reorder_try(int message_type, I3ipc_message** out_repl
             i3ipc__context_reserve(context, I3IPC_CONTEXT_REORDER, (i+1)*sizeof(buf[0]), (void**)&buf);
     
             size_t size = sizeof(*msg) + msg->message_length;
-            buf[i] = (I3ipc_message*)calloc(1, size);
+            buf[i] = (I3ipc_message*)i3ipc__malloc(size);
             memcpy(buf[i], msg, size);            
         }
     }
@@ -1446,12 +2370,19 @@ int i3ipc_message_receive_reorder_try(int message_type, I3ipc_message** out_repl
 
 #if I3IPC_ANONYMOUS_UNION
 
+/* If str_raw_size is nonzero, str points to the undecoded string (starting at the opening quote),
+ * which has that many bytes and is not zero-terminated. str_size is always the decoded length.
+ * Decoded strings are zero-terminated, unless the json must not be modified (see nomodify_flag).
+ * Numbers are kept as text, num points to the num_size bytes of it in the json.
+ * For '{' and '[' on the tape, match is the index of the closing token, or -1 if it is not known
+ * that everything in between is valid json. Not used in stream mode. */
 typedef struct I3ipc_json_token {
     int type;
     union {
-        struct { char* str; int str_size; };
-        struct { double number; size_t number_long; };
+        struct { char* str; int str_size; int str_raw_size; };
+        struct { char* num; int num_size; };
         bool flag;
+        int match;
     };
 } I3ipc_json_token;
 
@@ -1459,22 +2390,47 @@ typedef struct I3ipc_json_token {
 
 typedef struct I3ipc_json_token {
     int type;
-    char* str; int str_size;
-    double number; size_t number_long;
+    char* str; int str_size; int str_raw_size;
+    char* num; int num_size;
     bool flag;
+    int match;
 } I3ipc_json_token;
 
 #endif
 
+/* Tokens are unpacked from the tape this many at a time. Doing it for each token as needed is
+ * slower, as the unpacked token is immediately copied around. */
+#define I3IPC__TAPE_WINDOW 64
+
+/* In stream mode, tokens are not taken from the tape, but scanned from cur whenever they are
+ * needed. stream_tok holds the next token, if stream_peeked is set. */
 typedef struct I3ipc_json_state {
     char* cur;
     int left;
     bool err_flag;
     bool nomodify_flag;
-    I3ipc_json_token* tokens;
-    int tokens_size;
-    int tokens_capacity;
-    int tokens_cur;
+    uint64_t* tape;
+    char* tape_json;
+    int tape_size;
+    int tape_cur;
+    int tape_window_begin; /* index of tape_window[0] on the tape */
+    int tape_window_size;
+    I3ipc_json_token tape_window[I3IPC__TAPE_WINDOW];
+
+    /* State of i3ipc__json_scan_feed, so that scanning can continue when more json arrives */
+    int scan_expect;
+    int scan_open;
+    int scan_depth;
+    bool scan_done;
+
+    int depth; /* of the containers opened by i3ipc__json_looparr and i3ipc__json_loopobj */
+
+    bool stream_flag;
+    bool stream_peeked;
+    I3ipc_json_token stream_tok;
+    char* stream_tok_pos;
+    char* stream_begin;
+    int stream_begin_left;
 } I3ipc_json_state;
 
 enum I3ipc_json_token_type {
@@ -1483,155 +2439,513 @@ enum I3ipc_json_token_type {
     I3IPC_JSON_NULL,
     I3IPC_JSON_STRING,
     I3IPC_JSON_NUMBER,
+    I3IPC_JSON_INVALID, /* only in stream mode, when scanning fails */
     I3IPC_JSON_TOKEN_MAX
 };
 
-int i3ipc__json_scan_number(I3ipc_json_state* state, double* out_val, size_t* out_val_int) {
-    /* This a simple parser, i.e. no correct rounding, and no exponents */
-    int length = state->left;
-    for (int i = 0; i < state->left; ++i) {
-        char ic = state->cur[i];
-        bool isdigit = '0' <= ic && ic <= '9';
-        bool isother = ic == '-' || ic == '.' || ic == '+' || ic == 'e' || ic == 'E';
-        if (!isdigit && !isother) {
-            length = i;
-            break;
+/* Tokens are stored on the tape, packed into 64 bits each:
+ *   bits 60-63  type, as index into i3ipc__global_tape_types
+ *   bits 30-59  offset of str or num from tape_json
+ *   bits  0-29  str_size, num_size, flag, or match+1
+ * The json must be smaller than I3IPC__TAPE_MAX bytes. Strings that are not decoded (see
+ * nomodify_flag) have type 11, and str_raw_size instead of str_size, unless they contain no
+ * escapes. Then their contents are used as they are. */
+#define I3IPC__TAPE_MAX 0x3fffffff
+static int const i3ipc__global_tape_types[] = {
+    0, '{', '}', '[', ']', ':', ',', I3IPC_JSON_BOOL, I3IPC_JSON_NULL, I3IPC_JSON_STRING,
+    I3IPC_JSON_NUMBER, I3IPC_JSON_STRING
+};
+#define I3IPC__TAPE_TYPE(word) (i3ipc__global_tape_types[(word) >> 60])
+
+uint64_t i3ipc__tape_pack(I3ipc_json_token tok, char* json) {
+    uint64_t type = 0, offset = 0, value = 0;
+    switch (tok.type) {
+    case 0:                 type = 0; break;
+    case '{':               type = 1; value = tok.match + 1; break;
+    case '}':               type = 2; break;
+    case '[':               type = 3; value = tok.match + 1; break;
+    case ']':               type = 4; break;
+    case ':':               type = 5; break;
+    case ',':               type = 6; break;
+    case I3IPC_JSON_BOOL:   type = 7; value = tok.flag; break;
+    case I3IPC_JSON_NULL:   type = 8; break;
+    case I3IPC_JSON_STRING:
+        if (tok.str_raw_size == tok.str_size + 2) {
+            type = 9; offset = tok.str + 1 - json; value = tok.str_size;
+        } else if (tok.str_raw_size) {
+            type = 11; offset = tok.str - json; value = tok.str_raw_size;
+        } else {
+            type = 9; offset = tok.str - json; value = tok.str_size;
         }
+        break;
+    case I3IPC_JSON_NUMBER: type = 10; offset = tok.num - json; value = tok.num_size; break;
+    default: assert(false);
     }
-    if (length >= 256) {
-        fprintf(i3ipc__err, "number with length %d in json, this is too long\n", length);
-        return 1;
+    assert(i3ipc__global_tape_types[type] == tok.type);
+    return type << 60 | offset << 30 | value;
+}
+
+int i3ipc__json_scan_string(I3ipc_json_state* state, char* out);
+
+void i3ipc__tape_unpack(uint64_t word, char* json, I3ipc_json_token* out_tok) {
+    int offset = (int)(word >> 30 & I3IPC__TAPE_MAX);
+    int value  = (int)(word       & I3IPC__TAPE_MAX);
+    memset(out_tok, 0, sizeof(*out_tok));
+    out_tok->type = I3IPC__TAPE_TYPE(word);
+    if (word >> 60 == 11) {
+        /* Undecoded, only the length of the decoded string is needed */
+        I3ipc_json_state tmp;
+        memset(&tmp, 0, sizeof(tmp));
+        tmp.cur = json + offset;
+        tmp.left = value;
+        out_tok->str = json + offset;
+        out_tok->str_size = i3ipc__json_scan_string(&tmp, NULL);
+        out_tok->str_raw_size = value;
+        return;
+    }
+    switch (out_tok->type) {
+    case I3IPC_JSON_STRING: out_tok->str = json + offset; out_tok->str_size = value; break;
+    case I3IPC_JSON_NUMBER: out_tok->num = json + offset; out_tok->num_size = value; break;
+    case I3IPC_JSON_BOOL:   out_tok->flag = value; break;
+    case '{': case '[':     out_tok->match = value - 1; break;
     }
+}
 
-    char* c = (char*)alloca(length + 1);
-    memcpy(c, state->cur, length);
-    c[length] = 0;
-    state->cur += length;
-    state->left -= length;
+/* Return the match of a '{' or '[' on the tape, or change it to match */
+int i3ipc__tape_match(uint64_t word) {
+    return (int)(word & I3IPC__TAPE_MAX) - 1;
+}
+void i3ipc__tape_setmatch(uint64_t* word, int match) {
+    *word = (*word & ~(uint64_t)I3IPC__TAPE_MAX) | (uint64_t)(match + 1);
+}
 
-    bool flipsign = 0;
-    if (*c == '-') {
-        flipsign = 1;
-        ++c;
-    }
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define I3IPC__SWAR 1
+#else
+#define I3IPC__SWAR 0
+#endif
 
-    double val = 0;
-    size_t val_int = 0;
-    for (; '0' <= *c && *c <= '9'; ++c) {
-        val = 10.0 * val + (double)(*c - '0');
-        val_int = 10 * val_int + (*c - '0');
-    }
-    if (*c == '.') {
-        ++c;
-        unsigned long num = 0;
-        unsigned long den = 1;
-        for (int i = 0; i < 19 && '0' <= *c && *c <= '9'; ++i, ++c) {
-            num = 10*num + *c - '0';
-            den *= 10;
+/* Return the number of ascii digits at the start of str, which has size bytes. */
+int i3ipc__count_digits(char const* str, int size) {
+    int i = 0;
+#if I3IPC__SWAR
+    /* Check 8 bytes at a time. A byte is a digit, if its high nibble is 3, and it still is after
+     * adding 6. t has a nonzero byte for every non-digit (carries only affect later bytes). */
+    for (; i + 8 <= size; i += 8) {
+        uint64_t x;
+        memcpy(&x, str + i, 8);
+        uint64_t t = ((x & UINT64_C(0xf0f0f0f0f0f0f0f0)) ^ UINT64_C(0x3030303030303030))
+            | (((x + UINT64_C(0x0606060606060606)) & UINT64_C(0xf0f0f0f0f0f0f0f0)) ^ UINT64_C(0x3030303030303030));
+        if (t) {
+            uint64_t nonzero = (((t & UINT64_C(0x7f7f7f7f7f7f7f7f)) + UINT64_C(0x7f7f7f7f7f7f7f7f)) | t)
+                & UINT64_C(0x8080808080808080);
+            return i + __builtin_ctzll(nonzero) / 8;
         }
-        while ('0' <= *c && *c <= '9') ++c;
-        val += (double)num / (double)den;
-    }
-
-    if (*c) {
-        /* Exponents are not supported, i3 should not do this */
-        fprintf(i3ipc__err, "found json number with exponent, this is unsupported\n");
-        return 1;
     }
-    
-    if (out_val) *out_val = flipsign ? -val : val;
-    if (out_val_int) *out_val_int = flipsign ? -val_int : val_int;
-    return 0;
+#endif
+    while (i < size && '0' <= str[i] && str[i] <= '9') ++i;
+    return i;
 }
 
-int i3ipc__json_scan_string(I3ipc_json_state* state) {
-    char* p = state->cur;
-    int i;
-    for (i = 1; i < state->left;) {
-        if (state->cur[i] == '"') {
-            ++i;
-            break;
-        } else if (state->cur[i] == '\\') {
-            char ic;
-            switch (i+1 < state->left ? state->cur[i+1] : 0) {
-            case '"':  ic = '"';  break;
-            case '\\': ic = '\\'; break;
-            case '/':  ic = '/';  break;
-            case 'b':  ic = '\b'; break;
-            case 'f':  ic = '\f'; break;
-            case 'n':  ic = '\n'; break;
-            case 'r':  ic = '\r'; break;
-            case 't':  ic = '\t'; break;
-            case 'u':  ic = 'u'; break;
-            default:   ic = 0;    break;
-            }
-            if (ic == 'u') {
-                if (i+5 < state->left) {
-                    int cp = 0;
-                    bool valid = true;
-                    for (int j = i+2; j <= i+5; ++j) {
-                        char jc = state->cur[j];
-                        int val = '0' <= jc && jc <= '9' ? jc - '0' :
-                                  'A' <= jc && jc <= 'F' ? 10 + jc - 'A' :
-                                  'a' <= jc && jc <= 'f' ? 10 + jc - 'a' : -1;
-                        valid &= val != -1;
-                        cp = cp * 16 + val;
-                    }
+#if I3IPC__SWAR
+/* Return the value of the 8 digits at str */
+uint32_t i3ipc__parse_digits8(char const* str) {
+    uint64_t x;
+    memcpy(&x, str, 8);
+    x = (x & UINT64_C(0x0f0f0f0f0f0f0f0f)) * 2561 >> 8; /* pairs of digits */
+    x = (x & UINT64_C(0x00ff00ff00ff00ff)) * 6553601 >> 16; /* groups of four */
+    return (uint32_t)((x & UINT64_C(0x0000ffff0000ffff)) * UINT64_C(42949672960001) >> 32);
+}
+#endif
 
-                    if (valid) {
-                        i += 6;
-                        
-                        /* utf-8 encoding */
-                        if (cp <= 0x7f) {
-                            *p++ = cp;
-                        } else if (cp <= 0x7ff) {
-                            *p++ = 0xc0 | cp >> 6;
-                            *p++ = 0x80 | (cp & 0x3f);
-                        } else if (cp <= 0xffff) {
-                            *p++ = 0xe0 | cp >> 12;
-                            *p++ = 0x80 | (cp >> 6 & 0x3f);
-                            *p++ = 0x80 | (cp      & 0x3f);
-                        } else if (cp <= 0x10ffff) {
-                            *p++ = 0xf0 | cp >> 18;
-                            *p++ = 0x80 | (cp >> 12 & 0x3f);
-                            *p++ = 0x80 | (cp >>  6 & 0x3f);
-                            *p++ = 0x80 | (cp       & 0x3f);
-                        } else {
-                            /* invalid unicode codepoint */
-                            *p++ = (char)0xef;
-                            *p++ = (char)0xbf;
-                            *p++ = (char)0xbd;
-                        }
-                        continue;
-                    }
-                }
-            } else if (ic) {
-                i += 2;
-                *p++ = ic;
+/* Return the value of the json number num as a double, correctly rounded. */
+double i3ipc__json_number_float(char const* num, int num_size) {
+    static double const pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    
+    int i = 0;
+    bool negative = i < num_size && num[i] == '-';
+    i += negative;
+
+    /* Collect up to 19 significant digits into mantissa, the value is mantissa * 10^exp10 */
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exp10 = 0;
+    for (int frac = 0; frac < 2; ++frac) {
+        for (; i < num_size && '0' <= num[i] && num[i] <= '9'; ++i) {
+            if (mantissa == 0 && num[i] == '0') {
+                exp10 -= frac;
                 continue;
             }
+            if (significant < 19) {
+                mantissa = 10*mantissa + (num[i] - '0');
+                exp10 -= frac;
+            } else {
+                exp10 += !frac;
+            }
+            ++significant;
         }
-        *p++ = state->cur[i];
-        i += 1;
+        if (frac == 0 && i < num_size && num[i] == '.') {
+            ++i;
+        } else {
+            break;
+        }
+    }
+    if (i < num_size && (num[i] == 'e' || num[i] == 'E')) {
+        ++i;
+        bool exp_negative = i < num_size && num[i] == '-';
+        i += i < num_size && (num[i] == '-' || num[i] == '+');
+        int exp = 0;
+        for (; i < num_size && '0' <= num[i] && num[i] <= '9'; ++i) {
+            if (exp < 100000) exp = 10*exp + (num[i] - '0');
+        }
+        exp10 += exp_negative ? -exp : exp;
     }
 
-    int length = p - state->cur;
-    *p++ = 0;
-    state->cur += i;
-    state->left -= i;
-    return length;
+    if (mantissa == 0) {
+        return negative ? -0.0 : 0.0;
+    } else if (significant <= 19 && mantissa <= (UINT64_C(1) << 53) && -22 <= exp10 && exp10 <= 22) {
+        /* Both mantissa and the power of ten are exact, so a single operation rounds correctly */
+        double val = (double)mantissa;
+        val = exp10 < 0 ? val / pow10[-exp10] : val * pow10[exp10];
+        return negative ? -val : val;
+    }
+
+    /* Leave the hard cases to strtod. The length of numbers is limited by i3ipc__json_scan_number */
+    char buf[256];
+    assert(num_size < (int)sizeof(buf));
+    memcpy(buf, num, num_size);
+    buf[num_size] = 0;
+    char decimal_point = *localeconv()->decimal_point;
+    for (int j = 0; j < num_size; ++j) {
+        if (buf[j] == '.') buf[j] = decimal_point;
+    }
+    return strtod(buf, NULL);
 }
 
-int i3ipc__json_scan_token(I3ipc_json_state* state, I3ipc_json_token* out_tok) {
-    assert(state && out_tok);
+/* Return the value of the json number num as an integer. A fractional part is truncated. */
+size_t i3ipc__json_number_int(char const* num, int num_size) {
+    bool negative = num_size > 0 && num[0] == '-';
+    char const* p = num + negative;
+    int digits = i3ipc__count_digits(p, num_size - negative);
+    if (negative + digits != num_size) {
+        /* There is a fraction or an exponent */
+        double val = i3ipc__json_number_float(num, num_size);
+        if (0.0 <= val && val < 18446744073709551616.0) return (size_t)val;
+        if (-9223372036854775808.0 <= val && val < 0.0) return (size_t)(ssize_t)val;
+        return 0;
+    }
+
+    size_t val = 0;
+#if I3IPC__SWAR
+    for (; digits >= 8; digits -= 8, p += 8) {
+        val = 100000000 * val + i3ipc__parse_digits8(p);
+    }
+#endif
+    for (; digits > 0; --digits, ++p) {
+        val = 10 * val + (*p - '0');
+    }
+    return negative ? -val : val;
+}
+
+/* Scan the number at the current position and check that it is valid json. The number is not
+ * converted here, only the parser knows whether an integer or a float is needed. */
+int i3ipc__json_scan_number(I3ipc_json_state* state, char** out_num, int* out_num_size) {
+    char* c = state->cur;
+    int left = state->left;
+    
+    int i = c[0] == '-';
+    int n = i3ipc__count_digits(c + i, left - i);
+    bool valid = n > 0 && !(n > 1 && c[i] == '0');
+    i += n;
+    if (valid && i < left && c[i] == '.') {
+        ++i;
+        n = i3ipc__count_digits(c + i, left - i);
+        valid = n > 0;
+        i += n;
+    }
+    if (valid && i < left && (c[i] == 'e' || c[i] == 'E')) {
+        ++i;
+        i += i < left && (c[i] == '-' || c[i] == '+');
+        n = i3ipc__count_digits(c + i, left - i);
+        valid = n > 0;
+        i += n;
+    }
+    
+    if (!valid) {
+        fprintf(i3ipc__err, "invalid json number '%.*s'\n", i < left ? i+1 : i, c);
+        return 1;
+    }
+    if (i >= 256) {
+        fprintf(i3ipc__err, "number with length %d in json, this is too long\n", i);
+        return 1;
+    }
+    
+    state->cur += i;
+    state->left -= i;
+    if (out_num) *out_num = c;
+    if (out_num_size) *out_num_size = i;
+    return 0;
+}
+
+/* The lexer looks for the end of strings and whitespace in bulk, using the widest vector
+ * instructions available. Which ones are used is decided at runtime, see i3ipc__simd_select . */
+enum I3ipc__simd_level {
+    I3IPC__SIMD_SCALAR,
+    I3IPC__SIMD_SSE2,
+    I3IPC__SIMD_AVX2,
+    I3IPC__SIMD_COUNT
+};
+
+/* Return the index of the first '"' or '\\' in str, or size if there is none. */
+int i3ipc__find_quote_scalar(char const* str, int size) {
+    for (int i = 0; i < size; ++i) {
+        if (str[i] == '"' || str[i] == '\\') return i;
+    }
+    return size;
+}
+
+/* Return the index of the first character in str that is not json whitespace, or size. */
+int i3ipc__skip_space_scalar(char const* str, int size) {
+    for (int i = 0; i < size; ++i) {
+        char c = str[i];
+        if (!(c == ' ' || c == '\t' || c == '\n' || c == '\r')) return i;
+    }
+    return size;
+}
+
+#if I3IPC_SIMD
+
+int i3ipc__find_quote_sse2(char const* str, int size) {
+    __m128i quote = _mm_set1_epi8('"');
+    __m128i slash = _mm_set1_epi8('\\');
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const*)(str + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + i3ipc__find_quote_scalar(str + i, size - i);
+}
+
+int i3ipc__skip_space_sse2(char const* str, int size) {
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const*)(str + i));
+        __m128i space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),  _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))
+        );
+        int mask = ~_mm_movemask_epi8(space) & 0xffff;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + i3ipc__skip_space_scalar(str + i, size - i);
+}
+
+__attribute__((target("avx2")))
+int i3ipc__find_quote_avx2(char const* str, int size) {
+    __m256i quote = _mm256_set1_epi8('"');
+    __m256i slash = _mm256_set1_epi8('\\');
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i const*)(str + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + i3ipc__find_quote_sse2(str + i, size - i);
+}
+
+__attribute__((target("avx2")))
+int i3ipc__skip_space_avx2(char const* str, int size) {
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i const*)(str + i));
+        __m256i space = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))
+        );
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(space);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + i3ipc__skip_space_sse2(str + i, size - i);
+}
+
+#endif /* I3IPC_SIMD */
+
+static int i3ipc__global_simd_level;
+static int (*i3ipc__global_find_quote)(char const*, int) = &i3ipc__find_quote_scalar;
+static int (*i3ipc__global_skip_space)(char const*, int) = &i3ipc__skip_space_scalar;
+
+/* Use the vector instructions of the given level, or the best ones supported by the cpu if level
+ * is -1. If the cpu does not support level, the best supported one below it is used. Return the old
+ * level. */
+int i3ipc__simd_select(int level) {
+    int old = i3ipc__global_simd_level;
+    int supported = I3IPC__SIMD_SCALAR;
+#if I3IPC_SIMD
+    __builtin_cpu_init();
+    supported = __builtin_cpu_supports("avx2") ? I3IPC__SIMD_AVX2 : I3IPC__SIMD_SSE2;
+#endif
+    if (level == -1 || level > supported) level = supported;
+    
+    i3ipc__global_simd_level = level;
+    switch (level) {
+    case I3IPC__SIMD_SCALAR:
+        i3ipc__global_find_quote = &i3ipc__find_quote_scalar;
+        i3ipc__global_skip_space = &i3ipc__skip_space_scalar;
+        break;
+#if I3IPC_SIMD
+    case I3IPC__SIMD_SSE2:
+        i3ipc__global_find_quote = &i3ipc__find_quote_sse2;
+        i3ipc__global_skip_space = &i3ipc__skip_space_sse2;
+        break;
+    case I3IPC__SIMD_AVX2:
+        i3ipc__global_find_quote = &i3ipc__find_quote_avx2;
+        i3ipc__global_skip_space = &i3ipc__skip_space_avx2;
+        break;
+#endif
+    default: assert(false);
+    }
+    return old;
+}
+
+/* Parse the four hex digits at str, return -1 if there are not enough or they are invalid. */
+int i3ipc__json_hex4(char const* str, int size) {
+    if (size < 4) return -1;
+    int cp = 0;
+    for (int j = 0; j < 4; ++j) {
+        char jc = str[j];
+        int val = '0' <= jc && jc <= '9' ? jc - '0' :
+                  'A' <= jc && jc <= 'F' ? 10 + jc - 'A' :
+                  'a' <= jc && jc <= 'f' ? 10 + jc - 'a' : -1;
+        if (val == -1) return -1;
+        cp = cp * 16 + val;
+    }
+    return cp;
+}
+
+/* Write the utf-8 encoding of the codepoint cp into out, which may be NULL. Return the number of
+ * bytes. */
+int i3ipc__utf8_encode(char* out, int cp) {
+    char enc[4];
+    int enc_size;
+    if (cp <= 0x7f) {
+        enc[0] = cp;
+        enc_size = 1;
+    } else if (cp <= 0x7ff) {
+        enc[0] = 0xc0 | cp >> 6;
+        enc[1] = 0x80 | (cp & 0x3f);
+        enc_size = 2;
+    } else if (cp <= 0xffff) {
+        enc[0] = 0xe0 | cp >> 12;
+        enc[1] = 0x80 | (cp >> 6 & 0x3f);
+        enc[2] = 0x80 | (cp      & 0x3f);
+        enc_size = 3;
+    } else if (cp <= 0x10ffff) {
+        enc[0] = 0xf0 | cp >> 18;
+        enc[1] = 0x80 | (cp >> 12 & 0x3f);
+        enc[2] = 0x80 | (cp >>  6 & 0x3f);
+        enc[3] = 0x80 | (cp       & 0x3f);
+        enc_size = 4;
+    } else {
+        /* invalid unicode codepoint */
+        enc[0] = (char)0xef;
+        enc[1] = (char)0xbf;
+        enc[2] = (char)0xbd;
+        enc_size = 3;
+    }
+    if (out) memcpy(out, enc, enc_size);
+    return enc_size;
+}
+
+/* Decode the string at the current position into out and zero-terminate it, return its length.
+ * out may point to state->cur, as the output never overtakes the input. If out is NULL, only the
+ * length is computed. */
+int i3ipc__json_scan_string(I3ipc_json_state* state, char* out) {
+    char const* cur = state->cur;
+    int left = state->left;
+    int length = 0;
+    int i = 1;
+    while (i < left) {
+        /* Everything up to the next quote or backslash can be copied as-is */
+        int run = i3ipc__global_find_quote(cur + i, left - i);
+        if (out) memmove(out + length, cur + i, run);
+        length += run;
+        i += run;
+        if (i >= left) break;
+        
+        if (cur[i] == '"') {
+            ++i;
+            break;
+        }
+        
+        char ic;
+        switch (i+1 < left ? cur[i+1] : 0) {
+        case '"':  ic = '"';  break;
+        case '\\': ic = '\\'; break;
+        case '/':  ic = '/';  break;
+        case 'b':  ic = '\b'; break;
+        case 'f':  ic = '\f'; break;
+        case 'n':  ic = '\n'; break;
+        case 'r':  ic = '\r'; break;
+        case 't':  ic = '\t'; break;
+        case 'u':  ic = 'u'; break;
+        default:   ic = 0;    break;
+        }
+        if (ic == 'u') {
+            int cp = i3ipc__json_hex4(cur + i+2, left - (i+2));
+            if (cp != -1) {
+                i += 6;
+                if (0xd800 <= cp && cp <= 0xdbff) {
+                    /* High surrogate, combine it with the following low one */
+                    bool pair = i+1 < left && cur[i] == '\\' && cur[i+1] == 'u';
+                    int cp_low = pair ? i3ipc__json_hex4(cur + i+2, left - (i+2)) : -1;
+                    if (0xdc00 <= cp_low && cp_low <= 0xdfff) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (cp_low - 0xdc00);
+                        i += 6;
+                    } else {
+                        cp = 0xfffd;
+                    }
+                } else if (0xdc00 <= cp && cp <= 0xdfff) {
+                    cp = 0xfffd; /* unpaired low surrogate */
+                }
+                length += i3ipc__utf8_encode(out ? out + length : NULL, cp);
+                continue;
+            }
+        } else if (ic) {
+            i += 2;
+            if (out) out[length] = ic;
+            ++length;
+            continue;
+        }
+        
+        /* Invalid escape, keep the backslash */
+        if (out) out[length] = cur[i];
+        ++length;
+        i += 1;
+    }
+
+    if (out) out[length] = 0;
+    state->cur += i;
+    state->left -= i;
+    return length;
+}
+
+int i3ipc__json_scan_token(I3ipc_json_state* state, I3ipc_json_token* out_tok) {
+    assert(state && out_tok);
     I3ipc_json_token tok;
     memset(&tok, 0, sizeof(tok));
 
-    while (state->left) {
+    if (state->left) {
         char c = *state->cur;
-        if (!(c == ' ' || c == '\t' || c == '\n' || c == '\r')) break;
-        ++state->cur;
-        --state->left;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            int n = i3ipc__global_skip_space(state->cur, state->left);
+            state->cur += n;
+            state->left -= n;
+        }
     }
 
     if (state->left <= 0) {
@@ -1662,10 +2976,15 @@ int i3ipc__json_scan_token(I3ipc_json_state* state, I3ipc_json_token* out_tok) {
     } else if (c == '"') {
         tok.type = I3IPC_JSON_STRING;
         tok.str = state->cur;
-        tok.str_size = i3ipc__json_scan_string(state);
+        if (state->nomodify_flag) {
+            tok.str_size = i3ipc__json_scan_string(state, NULL);
+            tok.str_raw_size = state->cur - tok.str;
+        } else {
+            tok.str_size = i3ipc__json_scan_string(state, tok.str);
+        }
     } else if (c == '-' || ('0' <= c && c <= '9')) {
         tok.type = I3IPC_JSON_NUMBER;
-        if (i3ipc__json_scan_number(state, &tok.number, &tok.number_long)) return 1;
+        if (i3ipc__json_scan_number(state, &tok.num, &tok.num_size)) return 1;
     } else {
         /* Invalid token, i3 should not do this */
         fprintf(i3ipc__err, "Invalid character '%c' (code %d) at start of token\n", c, (int)c);
@@ -1678,27 +2997,290 @@ int i3ipc__json_scan_token(I3ipc_json_state* state, I3ipc_json_token* out_tok) {
     return 0;
 }
 
-int i3ipc__json_scan(I3ipc_context* context, I3ipc_json_state* state) {
+/* What the json grammar allows next, while scanning */
+enum I3ipc_json_expect {
+    I3IPC_JSON_EXPECT_VALUE,
+    I3IPC_JSON_EXPECT_VALUE_OR_CLOSE,
+    I3IPC_JSON_EXPECT_KEY,
+    I3IPC_JSON_EXPECT_KEY_OR_CLOSE,
+    I3IPC_JSON_EXPECT_COLON,
+    I3IPC_JSON_EXPECT_COMMA_OR_CLOSE,
+    I3IPC_JSON_EXPECT_END,
+    I3IPC_JSON_EXPECT_INVALID
+};
+
+/* Whether json containers may be nested depth levels deep, see i3ipc_set_max_depth. If not, an
+ * error is printed. */
+bool i3ipc__json_depth_ok(int depth) {
+    int max_depth = i3ipc__global_context.max_depth;
+    if (!max_depth) max_depth = I3IPC_MAX_DEPTH_DEFAULT;
+    if (depth <= max_depth) return true;
+    
+    fprintf(i3ipc__err, "json is nested more than %d levels deep\n", max_depth);
+    return false;
+}
+
+/* Whether the token at the start of str, which has size bytes, ends before str does. Then it can
+ * be scanned without knowing the rest of the json. */
+bool i3ipc__json_token_complete(char const* str, int size) {
+    assert(size > 0);
+    char c = str[0];
+    if (c == '"') {
+        for (int i = 1; i < size; i += 2) {
+            i += i3ipc__global_find_quote(str + i, size - i);
+            if (i >= size) return false;
+            if (str[i] == '"') return true;
+            /* skip the backslash and the escaped character */
+        }
+        return false;
+    } else if (c == '[' || c == ']' || c == '{' || c == '}' || c == ':' || c == ',') {
+        return true;
+    }
+
+    /* Numbers and literals end at the next delimiter */
+    for (int i = 1; i < size; ++i) {
+        char d = str[i];
+        if (d == ' ' || d == '\t' || d == '\n' || d == '\r' || d == '[' || d == ']' || d == '{'
+            || d == '}' || d == ':' || d == ',' || d == '"') return true;
+    }
+    return false;
+}
+
+/* Prepare state for scanning the json at json onto the tape, see i3ipc__json_scan_feed . Returns
+ * false if the json is too large for the tape. With I3IPC_PARSE_NONDESTRUCTIVE, the json is not
+ * modified. */
+bool i3ipc__json_scan_begin(I3ipc_context* context, I3ipc_json_state* state, char* json, int json_size) {
+    memset(state, 0, sizeof(*state));
+    state->cur = json;
+    state->left = 0;
+    state->tape_json = json;
+    state->tape_size = 0;
+    state->scan_expect = I3IPC_JSON_EXPECT_VALUE;
+    state->scan_open = -1;
+    state->scan_done = false;
+    state->nomodify_flag = (context->parseflags & I3IPC_PARSE_NONDESTRUCTIVE) != 0;
+    state->tape = (uint64_t*)context->buffers[I3IPC_CONTEXT_JSON];
+    return json_size <= I3IPC__TAPE_MAX;
+}
+
+/* Scan tokens onto the tape, from the first json_size bytes of the json. Tokens that might
+ * continue after that are left for the next call, unless final is set, which means that this is
+ * all of the json. Then scan_done is set on success.
+ * Additionally, this checks the structure of the json, to find the matching closing tokens of '{'
+ * and '[', so that i3ipc__json_skip can jump over them. Until a container is closed, its match
+ * member links to the enclosing one instead. After the first violation of the grammar, no more
+ * matches are recorded, as the parser has to report the error at the right place. */
+int i3ipc__json_scan_feed(I3ipc_context* context, I3ipc_json_state* state, int json_size, bool final) {
+    assert(json_size <= I3IPC__TAPE_MAX);
+    assert(!state->scan_done);
+    int expect = state->scan_expect;
+    int open = state->scan_open; /* innermost container that has not been closed */
+    state->left = json_size - (int)(state->cur - state->tape_json);
+    
     while (true) {
+        if (!final) {
+            int n = i3ipc__global_skip_space(state->cur, state->left);
+            state->cur += n;
+            state->left -= n;
+            if (!state->left || !i3ipc__json_token_complete(state->cur, state->left)) break;
+        }
+        
         I3ipc_json_token tok;
         if (i3ipc__json_scan_token(state, &tok)) return 1;
 
         i3ipc__context_reserve(context, I3IPC_CONTEXT_JSON,
-            (state->tokens_size+1) * sizeof(state->tokens[0]), (void**)&state->tokens);
+            (state->tape_size+1) * sizeof(state->tape[0]), (void**)&state->tape);
+
+        int index = state->tape_size;
+        bool is_open = tok.type == '{' || tok.type == '[';
+        if (is_open) tok.match = -1;
+        
+        bool valid = true;
+        bool is_value = expect == I3IPC_JSON_EXPECT_VALUE || expect == I3IPC_JSON_EXPECT_VALUE_OR_CLOSE;
+        switch (expect == I3IPC_JSON_EXPECT_INVALID ? -1 : tok.type) {
+        case -1:
+            break;
+        case '{':
+        case '[':
+            valid = is_value;
+            if (!valid) break;
+            if (!i3ipc__json_depth_ok(++state->scan_depth)) return 2;
+            tok.match = open;
+            open = index;
+            expect = tok.type == '{' ? I3IPC_JSON_EXPECT_KEY_OR_CLOSE : I3IPC_JSON_EXPECT_VALUE_OR_CLOSE;
+            break;
+        case '}':
+        case ']': {
+            char open_type = tok.type == '}' ? '{' : '[';
+            int expect_first = tok.type == '}' ? I3IPC_JSON_EXPECT_KEY_OR_CLOSE : I3IPC_JSON_EXPECT_VALUE_OR_CLOSE;
+            valid = open != -1 && I3IPC__TAPE_TYPE(state->tape[open]) == open_type
+                && (expect == expect_first || expect == I3IPC_JSON_EXPECT_COMMA_OR_CLOSE);
+            if (!valid) break;
+            int parent = i3ipc__tape_match(state->tape[open]);
+            i3ipc__tape_setmatch(&state->tape[open], index);
+            open = parent;
+            --state->scan_depth;
+            expect = open == -1 ? I3IPC_JSON_EXPECT_END : I3IPC_JSON_EXPECT_COMMA_OR_CLOSE;
+        } break;
+        case ':':
+            valid = expect == I3IPC_JSON_EXPECT_COLON;
+            expect = I3IPC_JSON_EXPECT_VALUE;
+            break;
+        case ',':
+            valid = expect == I3IPC_JSON_EXPECT_COMMA_OR_CLOSE;
+            if (!valid) break;
+            expect = I3IPC__TAPE_TYPE(state->tape[open]) == '{' ? I3IPC_JSON_EXPECT_KEY : I3IPC_JSON_EXPECT_VALUE;
+            break;
+        case 0:
+            valid = open == -1; /* unclosed containers */
+            break;
+        default:
+            if (tok.type == I3IPC_JSON_STRING
+                && (expect == I3IPC_JSON_EXPECT_KEY || expect == I3IPC_JSON_EXPECT_KEY_OR_CLOSE)) {
+                expect = I3IPC_JSON_EXPECT_COLON;
+            } else {
+                valid = is_value;
+                expect = open == -1 ? I3IPC_JSON_EXPECT_END : I3IPC_JSON_EXPECT_COMMA_OR_CLOSE;
+            }
+        }
+
+        if (!valid) {
+            /* None of the open containers is valid */
+            while (open != -1) {
+                int parent = i3ipc__tape_match(state->tape[open]);
+                i3ipc__tape_setmatch(&state->tape[open], -1);
+                open = parent;
+            }
+            expect = I3IPC_JSON_EXPECT_INVALID;
+        }
 
-        state->tokens[state->tokens_size++] = tok;
-        if (tok.type == 0) break;
+        state->tape[state->tape_size++] = i3ipc__tape_pack(tok, state->tape_json);
+        if (tok.type == 0) {
+            state->scan_done = true;
+            break;
+        }
     }
+    
+    state->scan_expect = expect;
+    state->scan_open = open;
     return 0;
 }
 
-I3ipc_json_token i3ipc__json_pop(I3ipc_json_state* state) {
-    assert(state->tokens_cur < state->tokens_size);
-    return state->tokens[state->tokens_cur++];
+/* Scan all tokens onto the tape. If nomodify is set, the json is not modified. */
+int i3ipc__json_scan(I3ipc_context* context, I3ipc_json_state* state, bool nomodify) {
+    int json_size = state->left;
+    bool fits = i3ipc__json_scan_begin(context, state, state->cur, json_size);
+    assert(fits);
+    state->nomodify_flag = nomodify;
+    return i3ipc__json_scan_feed(context, state, json_size, true);
+}
+
+/* Set up state to scan tokens on demand from the json in buf, instead of from the tape. */
+void i3ipc__json_stream_begin(I3ipc_json_state* state, char* buf, int buf_size) {
+    state->cur = buf;
+    state->left = buf_size;
+    state->stream_flag = true;
+    state->stream_peeked = false;
+    state->stream_begin = buf;
+    state->stream_begin_left = buf_size;
+}
+
+/* Go back to the beginning of the json, for another pass */
+void i3ipc__json_stream_rewind(I3ipc_json_state* state) {
+    assert(state->stream_flag);
+    state->cur = state->stream_begin;
+    state->left = state->stream_begin_left;
+    state->stream_peeked = false;
+    state->depth = 0;
+}
+
+/* Continue scanning at pos, which must be inside the json */
+void i3ipc__json_stream_seek(I3ipc_json_state* state, char* pos) {
+    assert(state->stream_flag);
+    state->left -= (int)(pos - state->cur);
+    state->cur = pos;
+    state->stream_peeked = false;
+}
+
+/* Unpack the tokens starting at tape_cur into the window */
+void i3ipc__json_tape_refill(I3ipc_json_state* state) {
+    int n = state->tape_size - state->tape_cur;
+    if (n > I3IPC__TAPE_WINDOW) n = I3IPC__TAPE_WINDOW;
+    for (int i = 0; i < n; ++i) {
+        i3ipc__tape_unpack(state->tape[state->tape_cur + i], state->tape_json, &state->tape_window[i]);
+    }
+    state->tape_window_begin = state->tape_cur;
+    state->tape_window_size = n;
+}
+
+void i3ipc__json_stream_peek(I3ipc_json_state* state) {
+    state->stream_tok_pos = state->cur;
+    if (i3ipc__json_scan_token(state, &state->stream_tok)) {
+        /* Scanning failed, the error message has been written. Do not scan any further. */
+        memset(&state->stream_tok, 0, sizeof(state->stream_tok));
+        state->stream_tok.type = I3IPC_JSON_INVALID;
+        state->cur += state->left;
+        state->left = 0;
+    }
+    state->stream_peeked = true;
 }
+
 I3ipc_json_token i3ipc__json_peek(I3ipc_json_state* state) {
-    assert(state->tokens_cur < state->tokens_size);
-    return state->tokens[state->tokens_cur];
+    if (state->stream_flag) {
+        if (!state->stream_peeked) i3ipc__json_stream_peek(state);
+        return state->stream_tok;
+    }
+    
+    assert(state->tape_cur < state->tape_size);
+    if ((unsigned)(state->tape_cur - state->tape_window_begin) >= (unsigned)state->tape_window_size) {
+        i3ipc__json_tape_refill(state);
+    }
+    return state->tape_window[state->tape_cur - state->tape_window_begin];
+}
+/* Move past the next token */
+void i3ipc__json_pop(I3ipc_json_state* state) {
+    if (state->stream_flag) {
+        i3ipc__json_peek(state);
+        state->stream_peeked = false;
+        return;
+    }
+    
+    assert(state->tape_cur < state->tape_size);
+    ++state->tape_cur;
+}
+
+/* Return the decoded contents of the string token tok, which has tok.str_size bytes. Undecoded
+ * strings are decoded into buf, if they fit, else NULL is returned. The result need not be
+ * zero-terminated. */
+char const* i3ipc__json_str(I3ipc_json_token tok, char* buf, int buf_size) {
+    assert(tok.type == I3IPC_JSON_STRING);
+    if (!tok.str_raw_size) return tok.str;
+    if (tok.str_raw_size == tok.str_size + 2) return tok.str + 1; /* no escapes */
+
+    if (tok.str_raw_size > buf_size) return NULL;
+    memcpy(buf, tok.str, tok.str_raw_size);
+    I3ipc_json_state tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.cur = buf;
+    tmp.left = tok.str_raw_size;
+    i3ipc__json_scan_string(&tmp, buf);
+    return buf;
+}
+
+/* Write the decoded contents of the string token tok into out, which has space for tok.str_size+1
+ * bytes, and zero-terminate them. */
+void i3ipc__json_str_copy(I3ipc_json_token tok, char* out) {
+    assert(tok.type == I3IPC_JSON_STRING);
+    if (tok.str_raw_size && tok.str_raw_size != tok.str_size + 2) {
+        I3ipc_json_state tmp;
+        memset(&tmp, 0, sizeof(tmp));
+        tmp.cur = tok.str;
+        tmp.left = tok.str_raw_size;
+        i3ipc__json_scan_string(&tmp, out);
+        return;
+    }
+    memcpy(out, tok.str_raw_size ? tok.str + 1 : tok.str, tok.str_size);
+    out[tok.str_size] = 0;
 }
 
 bool i3ipc__json_trymatchany(I3ipc_json_state* state, int type[], int type_size, I3ipc_json_token* out_tok) {
@@ -1718,7 +3300,7 @@ bool i3ipc__json_trymatchany(I3ipc_json_state* state, int type[], int type_size,
 }
 
 static char const* const i3ipc__global_token_type_name[] = {
-    "bool", "null", "string", "number"
+    "bool", "null", "string", "number", "invalid"
 };
 
 size_t i3ipc__printjson_string(FILE* f, char const* str, int str_size, bool for_human) {
@@ -1750,6 +3332,17 @@ size_t i3ipc__printjson_string(FILE* f, char const* str, int str_size, bool for_
     return written;
 }
 
+size_t i3ipc__json_token_err_string(I3ipc_json_token tok) {
+    if (tok.str_raw_size) {
+        /* Print undecoded strings as they are, they already contain the quotes */
+        int size = tok.str_raw_size > 200 ? 32 : tok.str_raw_size;
+        fwrite(tok.str, 1, size, i3ipc__err);
+        return size + (size < tok.str_raw_size ? fprintf(i3ipc__err, "...") : 0);
+    } else {
+        return i3ipc__printjson_string(i3ipc__err, tok.str, tok.str_size, true);
+    }
+}
+
 void i3ipc__json_token_err(I3ipc_json_token tok) {
     if (tok.type == 0) {
         fprintf(i3ipc__err, "eof");
@@ -1758,12 +3351,14 @@ void i3ipc__json_token_err(I3ipc_json_token tok) {
     } else if (tok.type == I3IPC_JSON_NULL) {
         fprintf(i3ipc__err, "'null'");
     } else if (tok.type == I3IPC_JSON_NUMBER) {
-        fprintf(i3ipc__err, "number %g", tok.number);
+        fprintf(i3ipc__err, "number %.*s", tok.num_size, tok.num);
     } else if (tok.type == I3IPC_JSON_STRING) {
         fputs("string ", i3ipc__err);
-        i3ipc__printjson_string(i3ipc__err, tok.str, tok.str_size, true);
+        i3ipc__json_token_err_string(tok);
     } else if (tok.type == I3IPC_JSON_BOOL) {
         fprintf(i3ipc__err, "bool '%s'", tok.flag ? "true" : "false");
+    } else if (tok.type == I3IPC_JSON_INVALID) {
+        fprintf(i3ipc__err, "invalid token");
     } else {
         assert(false);
     }
@@ -1794,13 +3389,32 @@ int i3ipc__json_matchany(I3ipc_json_state* state, int type[], int type_size, I3i
     fputs("\n", i3ipc__err);
 
     fputs("while parsing\n    ", i3ipc__err);
+    if (state->stream_flag) {
+        /* There are no tokens to print, show the surrounding json instead */
+        char* begin = state->stream_begin;
+        char* end = state->stream_begin + state->stream_begin_left;
+        if (state->stream_tok_pos - begin > 40) begin = state->stream_tok_pos - 40;
+        if (end - state->cur > 40) end = state->cur + 40;
+        for (char* i = begin; i < end; ++i) {
+            fputc(' ' <= *i && *i < 127 ? *i : ' ', i3ipc__err);
+        }
+        fprintf(i3ipc__err, "\n%*s^", 4+(int)(state->stream_tok_pos - begin), "");
+        for (char* i = state->stream_tok_pos + 1; i < state->cur; ++i) {
+            fputc('~', i3ipc__err);
+        }
+        fputc('\n', i3ipc__err);
+        return 1;
+    }
+    
     int n = 8;
-    int cur = state->tokens_cur; 
-    int token_first = cur - n >= 0                  ? cur - n : 0;
-    int token_last  = cur + n <= state->tokens_size ? cur + n : state->tokens_size;
+    int cur = state->tape_cur; 
+    int token_first = cur - n >= 0                ? cur - n : 0;
+    int token_last  = cur + n <= state->tape_size ? cur + n : state->tape_size;
     size_t cur_pos = 0, cur_size = 0;
     for (int i = token_first; i < token_last; ++i) {
-        I3ipc_json_token tok = state->tokens[i];
+        I3ipc_json_token tok;
+        memset(&tok, 0, sizeof(tok));
+        i3ipc__tape_unpack(state->tape[i], state->tape_json, &tok);
         size_t written = 0;
         if (tok.type < 256) {
             fputc(tok.type, i3ipc__err); ++written;
@@ -1811,12 +3425,7 @@ int i3ipc__json_matchany(I3ipc_json_state* state, int type[], int type_size, I3i
         } else if (tok.type == I3IPC_JSON_STRING) {
             written += i3ipc__printjson_string(i3ipc__err, tok.str, tok.str_size, true);
         } else if (tok.type == I3IPC_JSON_NUMBER) {
-            if (-9223372036854775808.0 <= tok.number && tok.number < 9223372036854775808.0
-                    && (double)(ssize_t)tok.number == tok.number) {
-                written += fprintf(i3ipc__err, "%ld", (long)tok.number_long);
-            } else {
-                written += fprintf(i3ipc__err, "%.10e", tok.number);
-            }
+            written += fprintf(i3ipc__err, "%.*s", tok.num_size, tok.num);
         } else {
             assert(false);
         }
@@ -1848,12 +3457,19 @@ bool i3ipc__json_looparr(I3ipc_json_state* state, int* io_iter) {
     assert(io_iter);
     if (*io_iter == 0) {
         if (i3ipc__json_match(state, '[', NULL)) goto err;
-        if (i3ipc__json_trymatch(state, ']', NULL)) return false;
+        if (!i3ipc__json_depth_ok(++state->depth)) goto err;
+        if (i3ipc__json_trymatch(state, ']', NULL)) {
+            --state->depth;
+            return false;
+        }
     } else {
         I3ipc_json_token tok;
         int type[] = {',', ']'};
         if (i3ipc__json_matchany(state, type, 2, &tok)) goto err;
-        if (tok.type != ',') return false;
+        if (tok.type != ',') {
+            --state->depth;
+            return false;
+        }
     }
     return true;
 
@@ -1866,12 +3482,19 @@ bool i3ipc__json_loopobj(I3ipc_json_state* state, int* io_iter, I3ipc_json_token
     assert(io_iter);
     if (*io_iter == 0) {
         if (i3ipc__json_match(state, '{', NULL)) goto err;
-        if (i3ipc__json_trymatch(state, '}', NULL)) return false;
+        if (!i3ipc__json_depth_ok(++state->depth)) goto err;
+        if (i3ipc__json_trymatch(state, '}', NULL)) {
+            --state->depth;
+            return false;
+        }
     } else {
         I3ipc_json_token tok;
         int type[] = {',', '}'};
         if (i3ipc__json_matchany(state, type, 2, &tok)) goto err;
-        if (tok.type != ',') return false;
+        if (tok.type != ',') {
+            --state->depth;
+            return false;
+        }
     }
 
     I3ipc_json_token key;
@@ -1885,29 +3508,66 @@ bool i3ipc__json_loopobj(I3ipc_json_state* state, int* io_iter, I3ipc_json_token
     return false;
 }
 
+/* Skip over the next json value. Instead of recursing into nested containers, this keeps a stack
+ * of them, with one bit each for whether it is an object. The stack starts out on the C stack and
+ * moves to the heap for deeply nested json. */
 int i3ipc__json_skip(I3ipc_json_state* state) {
-    I3ipc_json_token tok;
-    {int type[] = {'{', '[', I3IPC_JSON_STRING, I3IPC_JSON_NUMBER, I3IPC_JSON_BOOL, I3IPC_JSON_NULL};
-    int type_size = sizeof(type) / sizeof(type[0]);    
-    if (i3ipc__json_matchany(state, type, type_size, &tok)) return 1;}
-    
-    if (tok.type == '{') {
-        --state->tokens_cur;
-        for (int i = 0; i3ipc__json_loopobj(state, &i, NULL); ++i) {
-            if (i3ipc__json_skip(state)) return 4;
-        }
-        if (state->err_flag) return 9;
-    } else if (tok.type == '[') {
-        --state->tokens_cur;
-        for (int i = 0; i3ipc__json_looparr(state, &i); ++i) {
-            if (i3ipc__json_skip(state)) return 4;
-        }
-        if (state->err_flag) return 9;
-    } else {
-        /* nothing, the code above ensures that we only get a value here */
+    uint64_t objects_small[4];
+    uint64_t* objects = objects_small;
+    int objects_capacity = 64 * (int)(sizeof(objects_small) / sizeof(objects_small[0]));
+    int depth = 0;
+    int code = 0;
+    
+    while (true) {
+        /* The next value, which may open a container */
+        I3ipc_json_token tok = i3ipc__json_peek(state);
+        int iter = 0;
+        if (!state->stream_flag && (tok.type == '{' || tok.type == '[') && tok.match != -1) {
+            /* The contents are valid, jump over them */
+            state->tape_cur = tok.match + 1;
+            iter = 1;
+        } else if (tok.type == '{' || tok.type == '[') {
+            if (depth == objects_capacity) {
+                uint64_t* objects_next = (uint64_t*)i3ipc__malloc(2 * objects_capacity / 8);
+                memcpy(objects_next, objects, objects_capacity / 8);
+                if (objects != objects_small) i3ipc__free(objects);
+                objects = objects_next;
+                objects_capacity *= 2;
+            }
+            uint64_t bit = (uint64_t)1 << (depth & 63);
+            if (tok.type == '{') {
+                objects[depth >> 6] |= bit;
+            } else {
+                objects[depth >> 6] &= ~bit;
+            }
+            ++depth;
+        } else {
+            int type[] = {'{', '[', I3IPC_JSON_STRING, I3IPC_JSON_NUMBER, I3IPC_JSON_BOOL, I3IPC_JSON_NULL};
+            int type_size = sizeof(type) / sizeof(type[0]);    
+            if (i3ipc__json_matchany(state, type, type_size, &tok)) {
+                code = 1;
+                break;
+            }
+            iter = 1;
+        }
+        
+        /* Continue with the innermost open container, closing the ones that end */
+        while (depth > 0) {
+            bool is_object = objects[(depth-1) >> 6] >> ((depth-1) & 63) & 1;
+            bool more = is_object ? i3ipc__json_loopobj(state, &iter, NULL) : i3ipc__json_looparr(state, &iter);
+            if (more) break;
+            if (state->err_flag) {
+                code = 9;
+                break;
+            }
+            --depth;
+            iter = 1;
+        }
+        if (code || depth == 0) break;
     }
 
-    return 0;
+    if (objects != objects_small) i3ipc__free(objects);
+    return code;
 }
 
 int i3ipc__parse_key(I3ipc_json_state* state, I3ipc_json_token* out_key) {
@@ -1935,6 +3595,25 @@ enum I3ipc_type_flags {
     I3IPC_TYPE_GROUP_MAYBE   = I3IPC_TYPE_ISPTR | I3IPC_TYPE_ISOPT
 };
 
+/* A perfect hash mapping a fixed set of strings to their indices. Each slot contains the index plus
+ * one, or zero if it is empty. See i3ipc__strhash_init . */
+typedef struct I3ipc_strhash {
+    unsigned char* slots;
+    uint32_t mask;
+    uint32_t seed;
+} I3ipc_strhash;
+
+/* The values of an enum, in the order of their _enum constants. null_value is the value of a json
+ * null, if it is allowed, else -1. */
+typedef struct I3ipc_enum_table {
+    char const** values;
+    int* values_sizes;
+    int values_size;
+    int null_value;
+    I3ipc_strhash hash;
+} I3ipc_enum_table;
+
+/* For fields with I3IPC_TYPE_ISENUM, enum_table is the table of its values, if there is one. */
 typedef struct I3ipc_field {
     int type;
     int flags;
@@ -1942,8 +3621,11 @@ typedef struct I3ipc_field {
     int offset;
     char const* full_name;
     char const* json_name;
+    int json_name_size;
+    I3ipc_enum_table* enum_table;
 } I3ipc_field;
 
+/* field_hash maps the json names of the fields to their indices. */
 typedef struct I3ipc_type {
     int type;
     bool is_primitive;
@@ -1953,11 +3635,12 @@ typedef struct I3ipc_type {
     I3ipc_field* fields;
     int fields_size;
     char const* name;
+    I3ipc_strhash field_hash;
 } I3ipc_type;
 
-#define I3IPC__TYPE_BEGIN2(type, T, flags) {(type), I3IPC_TYPE_MARKER | flags, NULL, sizeof(T), (char*)I3IPC_ALIGNOF(T), #T}
+#define I3IPC__TYPE_BEGIN2(type, T, flags) {(type), I3IPC_TYPE_MARKER | flags, NULL, sizeof(T), (char*)I3IPC_ALIGNOF(T), #T, 0, NULL}
 #define I3IPC__TYPE_BEGIN(type, T) I3IPC__TYPE_BEGIN2(type, T, 0)
-#define I3IPC__DOFIELD2(T, subtype, name, flags) {(subtype), (flags), #name, offsetof(T, name), #T "." #name, NULL}
+#define I3IPC__DOFIELD2(T, subtype, name, flags) {(subtype), (flags), #name, offsetof(T, name), #T "." #name, NULL, 0, NULL}
 #define I3IPC__DOFIELD(T, subtype, name) I3IPC__DOFIELD2(T, subtype, name, 0) 
 #define I3IPC__DOPTR(T, subtype, name) I3IPC__DOFIELD2(T, subtype, name, I3IPC_TYPE_ISPTR) 
 #define I3IPC__DOMAYBE(T, subtype, name) \
@@ -2174,6 +3857,7 @@ static I3ipc_field i3ipc__global_fields[] = {
 #undef I3IPC__DOENUM
 
 static I3ipc_type i3ipc__global_types[I3IPC_TYPE_COUNT];
+static unsigned char i3ipc__global_strhash_slots[4096];
 
 static char const* i3ipc__global_enums[] = {
     /* There have to be in the same order as their respective enums */
@@ -2197,8 +3881,115 @@ static char const* i3ipc__global_enums[] = {
     "$$"
 };
 
+#define I3IPC__ENUMS_SIZE (sizeof(i3ipc__global_enums) / sizeof(i3ipc__global_enums[0]))
+static int i3ipc__global_enums_sizes[I3IPC__ENUMS_SIZE];
+static I3ipc_enum_table i3ipc__global_enum_tables[32];
+
+uint32_t i3ipc__strhash_hash(char const* str, int str_size, uint32_t seed) {
+    /* FNV-1a, with a seed mixed in */
+    uint32_t hash = 2166136261u ^ seed;
+    for (int i = 0; i < str_size; ++i) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash ^ hash >> 15;
+}
+
+/* Find a seed and a table size, such that the keys all hash to different slots. Then looking up a
+ * string needs only a single probe. Keys that are NULL are skipped. The slots are allocated from
+ * i3ipc__global_strhash_slots, io_used is the number of bytes already used. */
+void i3ipc__strhash_init(I3ipc_strhash* h, char const** keys, int* keys_sizes, int keys_size, int* io_used) {
+    assert(keys_size < 255);
+    int count = 0;
+    for (int i = 0; i < keys_size; ++i) {
+        if (keys[i]) ++count;
+    }
+
+    int size = 4;
+    while (size < 2*count) size *= 2;
+    while (true) {
+        assert(*io_used + size <= (int)sizeof(i3ipc__global_strhash_slots));
+        unsigned char* slots = i3ipc__global_strhash_slots + *io_used;
+
+        for (uint32_t seed = 0; seed < 256; ++seed) {
+            memset(slots, 0, size);
+            bool collision = false;
+            for (int i = 0; i < keys_size && !collision; ++i) {
+                if (!keys[i]) continue;
+                uint32_t slot = i3ipc__strhash_hash(keys[i], keys_sizes[i], seed) & (size-1);
+                collision = slots[slot] != 0;
+                slots[slot] = (unsigned char)(i+1);
+            }
+            if (!collision) {
+                h->slots = slots;
+                h->mask = size-1;
+                h->seed = seed;
+                *io_used += size;
+                return;
+            }
+        }
+        size *= 2;
+    }
+}
+
+/* Return the index of the key equal to str, or -1 if there is none. */
+int i3ipc__strhash_find(I3ipc_strhash* h, char const** keys, int* keys_sizes, char const* str, int str_size) {
+    if (!h->slots) return -1;
+    uint32_t slot = i3ipc__strhash_hash(str, str_size, h->seed) & h->mask;
+    int index = h->slots[slot] - 1;
+    if (index == -1) return -1;
+    if (keys_sizes[index] != str_size || memcmp(keys[index], str, str_size)) return -1;
+    return index;
+}
+
+/* Return the _enum constant for the value str (which may be NULL) */
+int i3ipc__enum_lookup(I3ipc_enum_table* t, char const* str, int str_size) {
+    if (!str) return t->null_value;
+    return i3ipc__strhash_find(&t->hash, t->values, t->values_sizes, str, str_size);
+}
+
+/* Resolve the "$Type.field" sections of i3ipc__global_enums into tables for the enum fields. */
+void i3ipc__init_enum_tables(int* io_hash_used) {
+    int tables_size = 0;
+    for (int i = 0; i < (int)I3IPC__ENUMS_SIZE; ++i) {
+        char const* s = i3ipc__global_enums[i];
+        i3ipc__global_enums_sizes[i] = s ? strlen(s) : 0;
+    }
+    
+    for (int i = 0; i < (int)I3IPC__ENUMS_SIZE; ++i) {
+        char const* s = i3ipc__global_enums[i];
+        if (!s || s[0] != '$' || strcmp(s, "$$") == 0) continue;
+
+        int start = i+1, end = start;
+        while (!i3ipc__global_enums[end] || i3ipc__global_enums[end][0] != '$') ++end;
+
+        assert(tables_size < (int)(sizeof(i3ipc__global_enum_tables) / sizeof(i3ipc__global_enum_tables[0])));
+        I3ipc_enum_table* t = &i3ipc__global_enum_tables[tables_size++];
+        t->values = (char const**)i3ipc__global_enums + start;
+        t->values_sizes = i3ipc__global_enums_sizes + start;
+        t->values_size = end - start;
+        t->null_value = -1;
+        for (int j = start; j < end; ++j) {
+            if (!i3ipc__global_enums[j]) t->null_value = j - start;
+        }
+        i3ipc__strhash_init(&t->hash, t->values, t->values_sizes, t->values_size, io_hash_used);
+
+        /* The enum field comes after the field for the string, see I3IPC__DOENUM2 */
+        int fields_size = sizeof(i3ipc__global_fields) / sizeof(i3ipc__global_fields[0]);
+        for (int j = 0; j+1 < fields_size; ++j) {
+            I3ipc_field* f = &i3ipc__global_fields[j];
+            if (f->flags & I3IPC_TYPE_MARKER || strcmp(f->full_name, s+1)) continue;
+            for (int k = j+1; k < fields_size; ++k) {
+                I3ipc_field* f_enum = &i3ipc__global_fields[k];
+                if (!(f_enum->flags & I3IPC_TYPE_GROUP_DERIVED)) break;
+                if (f_enum->flags & I3IPC_TYPE_ISENUM) f_enum->enum_table = t;
+            }
+        }
+    }
+}
+
 void i3ipc__init_globals(void) {
     i3ipc__err = open_memstream(&i3ipc__error_buf, &i3ipc__error_buf_size);
+    i3ipc__simd_select(-1);
 
     /* Set it to an invalid value, to catch errors */
     for (int i = 0; i < I3IPC_TYPE_COUNT; ++i) {
@@ -2234,9 +4025,29 @@ void i3ipc__init_globals(void) {
             } else {
                 f->json_name = f->name;
             }
+            f->json_name_size = strlen(f->json_name);
         }
     }}
 
+    {int hash_used = 0;
+    for (int i = I3IPC_TYPE_PRIMITIVE_COUNT; i < I3IPC_TYPE_COUNT; ++i) {
+        I3ipc_type* t = &i3ipc__global_types[i];
+        if (t->type == -1) continue;
+        
+        /* Derived fields do not appear in the json */
+        char const* keys[255];
+        int keys_sizes[255];
+        assert(t->fields_size < 255);
+        assert(t->fields_size <= 64); /* for the projection masks */
+        for (int j = 0; j < t->fields_size; ++j) {
+            bool derived = t->fields[j].flags & I3IPC_TYPE_GROUP_DERIVED;
+            keys[j] = derived ? NULL : t->fields[j].json_name;
+            keys_sizes[j] = t->fields[j].json_name_size;
+        }
+        i3ipc__strhash_init(&t->field_hash, keys, keys_sizes, t->fields_size, &hash_used);
+    }
+    i3ipc__init_enum_tables(&hash_used);}
+
     i3ipc__globals_initialized = true;
 }
 
@@ -2246,6 +4057,50 @@ I3ipc_type i3ipc__type_get(int type) {
     return i3ipc__global_types[type];
 }
 
+void i3ipc__type_readderived(I3ipc_type* type, int field, char* base, bool* out_set, int* out_size, int* out_enum) {
+    bool field_set = true;
+    int field_size = -1;
+    int field_enum = -1;
+    for (int j = field + 1; j < type->fields_size; ++j) {
+        I3ipc_field j_field = type->fields[j];
+        if (!(j_field.flags & I3IPC_TYPE_GROUP_DERIVED)) break;
+                
+        if (j_field.flags & I3IPC_TYPE_ISFLAG) {
+            assert(j_field.type == I3IPC_TYPE_BOOL);
+            field_set = *(bool*)(base + j_field.offset);
+        } else if (j_field.flags & I3IPC_TYPE_ISSIZE) {
+            assert(j_field.type == I3IPC_TYPE_INT);
+            field_size = *(int*)(base + j_field.offset);
+        } else if (j_field.flags & I3IPC_TYPE_ISENUM) {
+            assert(j_field.type == I3IPC_TYPE_INT);
+            field_enum = *(int*)(base + j_field.offset);
+        } else {
+            assert(false);
+        }
+    }
+
+    if (out_set) *out_set = field_set;
+    if (out_size) *out_size = field_size;
+    if (out_enum) *out_enum = field_enum;
+}
+
+/* Return the index of the field with the json name key, or -1 if there is none. */
+int i3ipc__type_findfield(I3ipc_type* type, I3ipc_json_token key) {
+    if (!type->field_hash.slots) return -1;
+    
+    char buf[256];
+    char const* str = i3ipc__json_str(key, buf, sizeof(buf));
+    if (!str) return -1; /* too long to be a field name */
+    
+    uint32_t slot = i3ipc__strhash_hash(str, key.str_size, type->field_hash.seed) & type->field_hash.mask;
+    int field = type->field_hash.slots[slot] - 1;
+    if (field == -1) return -1;
+    
+    I3ipc_field* f = &type->fields[field];
+    if (f->json_name_size != key.str_size || memcmp(f->json_name, str, key.str_size)) return -1;
+    return field;
+}
+
 bool i3ipc__parse_loopfields(I3ipc_json_state* state, I3ipc_type* type, int* io_field) {
     assert(io_field);
     int field = -1;
@@ -2256,14 +4111,7 @@ bool i3ipc__parse_loopfields(I3ipc_json_state* state, I3ipc_type* type, int* io_
         if (!i3ipc__json_loopobj(state, &j, &key)) return false;
         j = 1;
     
-        for (int i = 0; i < type->fields_size; ++i) {
-            if (type->fields[i].flags & I3IPC_TYPE_GROUP_DERIVED) continue;
-            if (strcmp(type->fields[i].json_name, key.str) == 0) {
-                field = i;
-                break;
-            }
-        }
-
+        field = i3ipc__type_findfield(type, key);
         if (field == -1) {
             if (i3ipc__json_skip(state)) return false;
         } else {
@@ -2275,27 +4123,198 @@ bool i3ipc__parse_loopfields(I3ipc_json_state* state, I3ipc_type* type, int* io_
     return true;
 }
 
-typedef struct I3ipc_parse_state_allocs {
-        size_t size, alignment;
-} I3ipc_parse_state_allocs;
+/* For each node of a lazy tree, where the json of its children starts, and whether they have been
+ * decoded. Positions are offsets into the json of the tree, or -1 if the member is not present. */
+typedef struct I3ipc_lazy_record {
+    I3ipc_node* node;
+    int pos; /* of the node itself, see i3ipc_raw_get */
+    int pos_nodes;
+    int pos_floating_nodes;
+    int pos_window_properties;
+    bool expanded;
+    uint64_t hash; /* of the json of the node, or 0 if it has not been computed yet */
+} I3ipc_lazy_record;
+
+struct I3ipc_lazy_tree {
+    char* json;
+    int json_size;
+
+    /* For each '[' and '{' in the json, ordered by position, the position of the bracket and of the
+     * matching closing bracket. */
+    int* bracket_open;
+    int* bracket_close;
+    int brackets_size;
+
+    /* Hash table mapping nodes to their records, using linear probing */
+    I3ipc_lazy_record* records;
+    int records_size;
+    int records_capacity;
+
+    I3ipc_arena arena;
+    I3ipc_node* root;
+};
 
-typedef struct I3ipc_parse_state {
-    I3ipc_context* context;
-    I3ipc_json_state state;
-    I3ipc_parse_state_allocs* allocs;
-    int allocs_size;
+/* Build the bracket index of the tree. Return nonzero if the brackets are unbalanced. */
+int i3ipc__lazy_index(I3ipc_lazy_tree* tree) {
+    char* json = tree->json;
+    int json_size = tree->json_size;
 
-    char* memory;
-    bool copy_strings;
+    int capacity = 64;
+    tree->bracket_open  = (int*)i3ipc__malloc(capacity * sizeof(int));
+    tree->bracket_close = (int*)i3ipc__malloc(capacity * sizeof(int));
+    tree->brackets_size = 0;
     
-    int next_size;
+    /* Indices of the brackets that are still open */
+    int stack_capacity = 64;
+    int* stack = (int*)i3ipc__malloc(stack_capacity * sizeof(int));
+    int stack_size = 0;
+    
+    for (int i = 0; i < json_size; ++i) {
+        char c = json[i];
+        if (c == '"') {
+            /* Skip the string, there may be brackets inside */
+            ++i;
+            while (i < json_size) {
+                i += i3ipc__global_find_quote(json + i, json_size - i);
+                if (i >= json_size || json[i] == '"') break;
+                i += 2; /* the backslash and the escaped character */
+            }
+            if (i >= json_size) {
+                fprintf(i3ipc__err, "unterminated json string\n");
+                i3ipc__free(stack);
+                return 1;
+            }
+        } else if (c == '[' || c == '{') {
+            if (tree->brackets_size == capacity) {
+                capacity *= 2;
+                tree->bracket_open  = (int*)i3ipc__realloc(tree->bracket_open,  capacity * sizeof(int));
+                tree->bracket_close = (int*)i3ipc__realloc(tree->bracket_close, capacity * sizeof(int));
+            }
+            if (stack_size == stack_capacity) {
+                stack_capacity *= 2;
+                stack = (int*)i3ipc__realloc(stack, stack_capacity * sizeof(int));
+            }
+            stack[stack_size++] = tree->brackets_size;
+            if (!i3ipc__json_depth_ok(stack_size)) {
+                i3ipc__free(stack);
+                return 4;
+            }
+            tree->bracket_open[tree->brackets_size] = i;
+            tree->bracket_close[tree->brackets_size] = -1;
+            ++tree->brackets_size;
+        } else if (c == ']' || c == '}') {
+            int open = stack_size ? tree->bracket_open[stack[stack_size-1]] : -1;
+            if (open == -1 || json[open] != (c == ']' ? '[' : '{')) {
+                fprintf(i3ipc__err, "unbalanced '%c' in json\n", c);
+                i3ipc__free(stack);
+                return 2;
+            }
+            tree->bracket_close[stack[--stack_size]] = i;
+        }
+    }
+    int unclosed = stack_size ? stack[stack_size-1] : -1;
+    i3ipc__free(stack);
+    
+    if (unclosed != -1) {
+        fprintf(i3ipc__err, "unbalanced '%c' in json\n", json[tree->bracket_open[unclosed]]);
+        return 3;
+    }
+    return 0;
+}
+
+/* Return the position of the bracket matching the one at pos. */
+int i3ipc__lazy_close(I3ipc_lazy_tree* tree, int pos) {
+    int lo = 0, hi = tree->brackets_size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (tree->bracket_open[mid] < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    assert(lo < tree->brackets_size && tree->bracket_open[lo] == pos);
+    return tree->bracket_close[lo];
+}
+
+/* Return the record of node. If insert is set, a new record is created if necessary, else NULL is
+ * returned if there is none. */
+I3ipc_lazy_record* i3ipc__lazy_record(I3ipc_lazy_tree* tree, I3ipc_node* node, bool insert) {
+    if (insert && 2 * (tree->records_size + 1) > tree->records_capacity) {
+        I3ipc_lazy_record* records_old = tree->records;
+        int capacity_old = tree->records_capacity;
+        tree->records_capacity = capacity_old ? 2 * capacity_old : 64;
+        tree->records = (I3ipc_lazy_record*)i3ipc__calloc(tree->records_capacity, sizeof(I3ipc_lazy_record));
+        tree->records_size = 0;
+        for (int i = 0; i < capacity_old; ++i) {
+            if (!records_old[i].node) continue;
+            *i3ipc__lazy_record(tree, records_old[i].node, true) = records_old[i];
+        }
+        i3ipc__free(records_old);
+    }
+    if (!tree->records_capacity) return NULL;
+
+    uint32_t mask = (uint32_t)tree->records_capacity - 1;
+    uint32_t slot = (uint32_t)(((uint64_t)(size_t)node * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & mask;
+    for (;; slot = (slot + 1) & mask) {
+        I3ipc_lazy_record* record = &tree->records[slot];
+        if (record->node == node) return record;
+        if (record->node) continue;
+        if (!insert) return NULL;
+
+        record->node = node;
+        record->pos = -1;
+        record->pos_nodes = -1;
+        record->pos_floating_nodes = -1;
+        record->pos_window_properties = -1;
+        ++tree->records_size;
+        return record;
+    }
+}
+
+typedef struct I3ipc_parse_state_allocs {
+        size_t size, alignment;
+} I3ipc_parse_state_allocs;
+
+/* A subtree of a GET_TREE reply that is parsed on its own, see i3ipc__parallel_parse */
+typedef struct I3ipc_parallel_task {
+    int pos; /* tape index of the '{' of the node */
+    int code;
+    I3ipc_node node;
+} I3ipc_parallel_task;
+
+typedef struct I3ipc_parse_state {
+    I3ipc_context* context;
+    I3ipc_json_state state;
+    I3ipc_parse_state_allocs* allocs;
+    int allocs_size;
+
+    char* memory;
+    bool copy_strings;
+    I3ipc_intern* intern; /* only for I3IPC_PARSE_INTERN */
+
+    /* Only for I3IPC_PARSE_SINGLEPASS. live_size is an upper bound for the memory needed by the
+     * result, excluding the space wasted by growing arrays. */
+    I3ipc_arena* arena;
+    size_t live_size;
+
+    /* Only for lazy trees. The children of the node being parsed are not decoded, instead their
+     * positions are stored in lazy_record. */
+    I3ipc_lazy_tree* lazy_tree;
+    I3ipc_lazy_record* lazy_record;
+
+    /* Only for I3IPC_PARSE_PARALLEL. The nodes that have already been parsed, in tape order, and
+     * the next one to be encountered. */
+    I3ipc_parallel_task* parallel_tasks;
+    int parallel_size;
+    int parallel_next;
+    
+    int next_size;
     char* next_enum;
     bool next_set;
 } I3ipc_parse_state;
 
 void i3ipc__parse_doderived(I3ipc_parse_state* p, I3ipc_type* type, int field, char* base) {
-    I3ipc_field f0 = type->fields[field];
-    
     for (int i = field+1; i < type->fields_size; ++i) {
         I3ipc_field f = type->fields[i];
         if (!(f.flags & I3IPC_TYPE_GROUP_DERIVED)) break;
@@ -2310,25 +4329,8 @@ void i3ipc__parse_doderived(I3ipc_parse_state* p, I3ipc_type* type, int field, c
             
         } else if (f.flags & I3IPC_TYPE_ISENUM) {
             assert(f.type == I3IPC_TYPE_INT);
-            int size = sizeof(i3ipc__global_enums) / sizeof(i3ipc__global_enums[0]);
-            int start = -1;
-            for (int j = 0; j < size; ++j) {
-                char const* s = i3ipc__global_enums[j];
-                if (s && s[0] == '$' && strcmp(s+1, f0.full_name) == 0) {
-                    start = j+1;
-                    break;
-                }
-            }
-            if (start == -1) continue;
-            int val_enum = -1;
-            for (int j = start;; ++j) {
-                char const* s = i3ipc__global_enums[j];
-                if (s && s[0] == '$') break;
-                if (s && p->next_enum ? strcmp(s, p->next_enum) == 0 : s == p->next_enum) {
-                    val_enum = j - start;
-                    break;
-                }
-            }
+            if (!f.enum_table) continue;
+            int val_enum = i3ipc__enum_lookup(f.enum_table, p->next_enum, p->next_size);
             *(int*)(base + f.offset) = val_enum;
         } else {
             assert(false);
@@ -2337,6 +4339,11 @@ void i3ipc__parse_doderived(I3ipc_parse_state* p, I3ipc_type* type, int field, c
 }
 
 char* i3ipc__parse_alloc(I3ipc_parse_state* p, size_t size, size_t alignment, int* out_handle) {
+    if (p->arena) {
+        p->live_size += size + alignment-1;
+        return i3ipc__arena_alloc(p->arena, size, alignment);
+    }
+    
     if (out_handle) *out_handle = p->allocs_size;
     if (!p->memory) {
         size_t next_size = (p->allocs_size + 1) * sizeof(p->allocs[0]);
@@ -2350,11 +4357,1442 @@ char* i3ipc__parse_alloc(I3ipc_parse_state* p, size_t size, size_t alignment, in
     }
 }
 
+/* Longer strings are unlikely to repeat, so they are not interned, which saves hashing them. Strings
+ * at most I3IPC__INTERN_POOL_MAX_SIZE long are put into the pool of I3IPC_PARSE_INTERN_POOL. */
+#define I3IPC__INTERN_MAX_SIZE 256
+#define I3IPC__INTERN_POOL_MAX_SIZE 64
+
+/* Return the interned copy of str, which has str_size bytes, see I3IPC_PARSE_INTERN. The copy is
+ * zero-terminated, str need not be. In the first pass of a two-pass parse, this only allocates. */
+char* i3ipc__parse_intern(I3ipc_parse_state* p, char const* str, int str_size) {
+    bool is_new;
+    I3ipc_context* context = p->context;
+    if ((context->parseflags & I3IPC_PARSE_INTERN_POOL) && str_size <= I3IPC__INTERN_POOL_MAX_SIZE) {
+        I3ipc_intern* pool = &context->intern_pool;
+        I3ipc_intern_entry* entry = i3ipc__intern_find(pool, str, str_size, true, &is_new);
+        if (is_new) {
+            entry->copy = i3ipc__arena_alloc(&pool->arena, str_size + 1, 1);
+            memcpy(entry->copy, str, str_size);
+            entry->copy[str_size] = 0;
+            entry->str = entry->copy;
+        }
+        return entry->copy;
+    }
+    
+    /* Only the first occurrence is allocated, in both passes. It is found again by its position. */
+    I3ipc_intern_entry* entry = i3ipc__intern_find(p->intern, str, str_size, true, &is_new);
+    if (is_new || (p->memory && entry->str == str)) {
+        entry->copy = i3ipc__parse_alloc(p, str_size + 1, 1, NULL);
+        if (entry->copy) {
+            memcpy(entry->copy, str, str_size);
+            entry->copy[str_size] = 0;
+        }
+    }
+    return entry->copy;
+}
+
+/* If the field at offset of the node being parsed is one of its children, record its position and
+ * skip over it. Return whether that happened. */
+bool i3ipc__parse_lazy_skip(I3ipc_parse_state* p, I3ipc_lazy_record* record, size_t offset) {
+    int* pos;
+    int tok_type = '[';
+    if (offset == offsetof(I3ipc_node, nodes)) {
+        pos = &record->pos_nodes;
+    } else if (offset == offsetof(I3ipc_node, floating_nodes)) {
+        pos = &record->pos_floating_nodes;
+    } else if (offset == offsetof(I3ipc_node, window_properties)) {
+        pos = &record->pos_window_properties;
+        tok_type = '{';
+    } else {
+        return false;
+    }
+
+    /* Anything else is left to the parser, which reports the error */
+    if (i3ipc__json_peek(&p->state).type != tok_type) return false;
+
+    I3ipc_lazy_tree* tree = p->lazy_tree;
+    *pos = (int)(p->state.cur - 1 - tree->json);
+    int close = i3ipc__lazy_close(tree, *pos);
+    
+    /* Continue after the closing bracket */
+    i3ipc__json_stream_seek(&p->state, tree->json + close + 1);
+    return true;
+}
+
+/* Return where the string tok is stored in the result. This is NULL in the first pass of a two-pass
+ * parse, unless the strings are not copied. Undecoded strings are decoded into the copy. */
+char* i3ipc__parse_string(I3ipc_parse_state* p, I3ipc_json_token tok) {
+    if (tok.str_raw_size == tok.str_size + 2) {
+        /* There is nothing to decode */
+        tok.str += 1;
+        tok.str_raw_size = 0;
+    }
+    
+    if (p->intern && !tok.str_raw_size && tok.str_size <= I3IPC__INTERN_MAX_SIZE) {
+        return i3ipc__parse_intern(p, tok.str, tok.str_size);
+    } else if (p->copy_strings) {
+        char* str_base = i3ipc__parse_alloc(p, tok.str_size + 1, 1, NULL);
+        if (str_base) i3ipc__json_str_copy(tok, str_base);
+        return str_base;
+    } else {
+        return tok.str;
+    }
+}
+
+/* Whether the node at the current position has been parsed on another thread already, see
+ * i3ipc__parallel_parse */
+bool i3ipc__parse_parallel_ready(I3ipc_parse_state* p) {
+    return p->parallel_next < p->parallel_size && p->state.tape_cur == p->parallel_tasks[p->parallel_next].pos;
+}
+
+/* Copy the node from the other thread into base and skip over its json */
+int i3ipc__parse_parallel_take(I3ipc_parse_state* p, char* base) {
+    assert(base);
+    memcpy(base, &p->parallel_tasks[p->parallel_next++].node, sizeof(I3ipc_node));
+    return i3ipc__json_skip(&p->state);
+}
+
+#if I3IPC_GENERATED_PARSERS
+
+/* These are called by the generated parsers. Like in i3ipc__parse_helper, the outputs are NULL in
+ * the first pass of a two-pass parse, and nothing is written then. */
+
+typedef int (*I3ipc_gen_parse)(I3ipc_parse_state* p, char* base);
+
+int i3ipc__gen_bool(I3ipc_parse_state* p, bool* out) {
+    I3ipc_json_token tok;
+    if (i3ipc__json_match(&p->state, I3IPC_JSON_BOOL, &tok)) return 1;
+    if (out) *out = tok.flag;
+    return 0;
+}
+
+int i3ipc__gen_int(I3ipc_parse_state* p, int* out) {
+    I3ipc_json_token tok;
+    if (i3ipc__json_match(&p->state, I3IPC_JSON_NUMBER, &tok)) return 1;
+    if (out) *out = (int)i3ipc__json_number_int(tok.num, tok.num_size);
+    return 0;
+}
+
+int i3ipc__gen_float(I3ipc_parse_state* p, float* out) {
+    I3ipc_json_token tok;
+    if (i3ipc__json_match(&p->state, I3IPC_JSON_NUMBER, &tok)) return 1;
+    if (out) *out = (float)i3ipc__json_number_float(tok.num, tok.num_size);
+    return 0;
+}
+
+int i3ipc__gen_sizet(I3ipc_parse_state* p, size_t* out) {
+    I3ipc_json_token tok;
+    if (i3ipc__json_match(&p->state, I3IPC_JSON_NUMBER, &tok)) return 1;
+    if (out) *out = i3ipc__json_number_int(tok.num, tok.num_size);
+    return 0;
+}
+
+/* If maybe is set, a json null is allowed and yields a NULL string */
+int i3ipc__gen_string(I3ipc_parse_state* p, bool maybe, char** out_str, int* out_size) {
+    if (maybe && i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {
+        *out_str = NULL;
+        *out_size = 0;
+        return 0;
+    }
+    
+    I3ipc_json_token tok;
+    if (i3ipc__json_match(&p->state, I3IPC_JSON_STRING, &tok)) return 1;
+    *out_str = i3ipc__parse_string(p, tok);
+    *out_size = tok.str_size;
+    return 0;
+}
+
+/* Parsers for array elements of primitive types and I3ipc_string */
+int i3ipc__gen_bool_el (I3ipc_parse_state* p, char* base) { return i3ipc__gen_bool (p, (bool*)  base); }
+int i3ipc__gen_int_el  (I3ipc_parse_state* p, char* base) { return i3ipc__gen_int  (p, (int*)   base); }
+int i3ipc__gen_float_el(I3ipc_parse_state* p, char* base) { return i3ipc__gen_float(p, (float*) base); }
+int i3ipc__gen_sizet_el(I3ipc_parse_state* p, char* base) { return i3ipc__gen_sizet(p, (size_t*)base); }
+
+int i3ipc__gen_string_el(I3ipc_parse_state* p, char* base) {
+    char* str;
+    int str_size;
+    if (i3ipc__gen_string(p, false, &str, &str_size)) return 1;
+    if (base) {
+        ((I3ipc_string*)base)->str = str;
+        ((I3ipc_string*)base)->str_size = str_size;
+    }
+    return 0;
+}
+
+/* Parse an array, with parse_el for each element. This does the same as the array cases of
+ * i3ipc__parse_helper. */
+int i3ipc__gen_array(I3ipc_parse_state* p, size_t size, size_t alignment, I3ipc_gen_parse parse_el,
+        char** out_arr, int* out_size) {
+    int i;
+    if (p->arena) {
+        assert(out_arr);
+        char* elem = (char*)alloca(size + alignment);
+        elem += -(size_t)elem & (alignment-1);
+        
+        char* arr_base = NULL;
+        int arr_capacity = 0;
+        for (i = 0; i3ipc__json_looparr(&p->state, &i); ++i) {
+            memset(elem, 0, size);
+            if (parse_el(p, elem)) return 6;
+
+            if (i == arr_capacity) {
+                arr_capacity = arr_capacity ? 2 * arr_capacity : 4;
+                char* arr_next = i3ipc__arena_alloc(p->arena, arr_capacity * size, alignment);
+                if (i) memcpy(arr_next, arr_base, i * size);
+                arr_base = arr_next;
+            }
+            memcpy(arr_base + i * size, elem, size);
+        }
+        if (p->state.err_flag) return 9;
+
+        if (arr_base) {
+            i3ipc__arena_shrink(p->arena, arr_base, arr_capacity * size, i * size);
+        } else {
+            arr_base = i3ipc__arena_alloc(p->arena, 0, alignment);
+        }
+        p->live_size += i * size + alignment-1;
+        *out_arr = arr_base;
+    } else {
+        int index;
+        char* arr_base = i3ipc__parse_alloc(p, -1, alignment, &index);
+        if (out_arr) *out_arr = arr_base;
+        
+        for (i = 0; i3ipc__json_looparr(&p->state, &i); ++i) {
+            if (parse_el(p, out_arr ? arr_base + i * size : NULL)) return 6;
+        }
+        if (p->state.err_flag) return 9;
+        
+        if (!out_arr) p->allocs[index].size = i * size;
+    }
+    *out_size = i;
+    return 0;
+}
+
+#endif /* I3IPC_GENERATED_PARSERS */
+
+/* Begin of generated parsers, see misc/gen-parsers.py */
+#if I3IPC_GENERATED_PARSERS
+
+int i3ipc__gen_rect(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_node_window_properties(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_node(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_bar_config_colors(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_bar_config(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_command_el(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_command(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_workspaces_el(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_workspaces(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_subscribe(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_outputs_el(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_outputs(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_tree(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_marks(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_bar_config_ids(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_bar_config(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_version(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_binding_modes(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_config(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_tick(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_reply_sync(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_workspace(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_output(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_mode(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_window(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_barconfig_update(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_binding_binding(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_binding(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_shutdown(I3ipc_parse_state* p, char* base);
+int i3ipc__gen_event_tick(I3ipc_parse_state* p, char* base);
+
+int i3ipc__gen_rect(I3ipc_parse_state* p, char* base) {
+    I3ipc_rect* obj = (I3ipc_rect*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_RECT];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_RECT], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* x */
+            if (i3ipc__gen_int(p, obj ? &obj->x : NULL)) return 3;
+        } break;
+        case 1: { /* y */
+            if (i3ipc__gen_int(p, obj ? &obj->y : NULL)) return 3;
+        } break;
+        case 2: { /* width */
+            if (i3ipc__gen_int(p, obj ? &obj->width : NULL)) return 3;
+        } break;
+        case 3: { /* height */
+            if (i3ipc__gen_int(p, obj ? &obj->height : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_node_window_properties(I3ipc_parse_state* p, char* base) {
+    I3ipc_node_window_properties* obj = (I3ipc_node_window_properties*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_NODE_WINDOW_PROPERTIES];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_NODE_WINDOW_PROPERTIES], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* title */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->title = str;
+                obj->title_size = str_size;
+            }
+        } break;
+        case 2: { /* instance */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->instance = str;
+                obj->instance_size = str_size;
+            }
+        } break;
+        case 4: { /* window_class */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->window_class = str;
+                obj->window_class_size = str_size;
+            }
+        } break;
+        case 6: { /* window_role */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->window_role = str;
+                obj->window_role_size = str_size;
+            }
+        } break;
+        case 8: { /* transient_for */
+            bool set = !i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL);
+            if (set && i3ipc__gen_int(p, obj ? &obj->transient_for : NULL)) return 3;
+            if (obj) obj->transient_for_set = set;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_node(I3ipc_parse_state* p, char* base) {
+    I3ipc_node* obj = (I3ipc_node*)base;
+    if (i3ipc__parse_parallel_ready(p)) return i3ipc__parse_parallel_take(p, base);
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_NODE];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_NODE], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* id */
+            if (i3ipc__gen_sizet(p, obj ? &obj->id : NULL)) return 3;
+        } break;
+        case 1: { /* name */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->name = str;
+                obj->name_size = str_size;
+            }
+        } break;
+        case 3: { /* type */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->type = str;
+                obj->type_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_NODE].fields[5].enum_table;
+                if (table) obj->type_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 6: { /* border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->border = str;
+                obj->border_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_NODE].fields[8].enum_table;
+                if (table) obj->border_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 9: { /* current_border_width */
+            if (i3ipc__gen_int(p, obj ? &obj->current_border_width : NULL)) return 3;
+        } break;
+        case 10: { /* layout */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->layout = str;
+                obj->layout_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_NODE].fields[12].enum_table;
+                if (table) obj->layout_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 13: { /* orientation */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->orientation = str;
+                obj->orientation_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_NODE].fields[15].enum_table;
+                if (table) obj->orientation_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 16: { /* percent */
+            bool set = !i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL);
+            if (set && i3ipc__gen_float(p, obj ? &obj->percent : NULL)) return 3;
+            if (obj) obj->percent_set = set;
+        } break;
+        case 18: { /* rect */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->rect : NULL)) return 3;
+        } break;
+        case 19: { /* window_rect */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->window_rect : NULL)) return 3;
+        } break;
+        case 20: { /* deco_rect */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->deco_rect : NULL)) return 3;
+        } break;
+        case 21: { /* geometry */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->geometry : NULL)) return 3;
+        } break;
+        case 22: { /* window */
+            bool set = !i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL);
+            if (set && i3ipc__gen_int(p, obj ? &obj->window : NULL)) return 3;
+            if (obj) obj->window_set = set;
+        } break;
+        case 24: { /* window_properties */
+            if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {
+                char* ptr = i3ipc__parse_alloc(p, sizeof(I3ipc_node_window_properties), I3IPC_ALIGNOF(I3ipc_node_window_properties), NULL);
+                if (obj) obj->window_properties = (I3ipc_node_window_properties*)ptr;
+                if (i3ipc__gen_node_window_properties(p, ptr)) return 3;
+            }
+        } break;
+        case 25: { /* window_type */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->window_type = str;
+                obj->window_type_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_NODE].fields[27].enum_table;
+                if (table) obj->window_type_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 28: { /* urgent */
+            if (i3ipc__gen_bool(p, obj ? &obj->urgent : NULL)) return 3;
+        } break;
+        case 29: { /* marks */
+            char* arr;
+            int arr_size = 0;
+            if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {
+                arr = NULL;
+                if (i3ipc__gen_array(p, sizeof(I3ipc_string), I3IPC_ALIGNOF(I3ipc_string), &i3ipc__gen_string_el, obj ? &arr : NULL, &arr_size)) return 3;
+                if (obj) obj->marks = (I3ipc_string*)arr;
+            }
+            if (obj) obj->marks_size = arr_size;
+        } break;
+        case 31: { /* focused */
+            if (i3ipc__gen_bool(p, obj ? &obj->focused : NULL)) return 3;
+        } break;
+        case 32: { /* focus */
+            char* arr;
+            int arr_size = 0;
+            if (i3ipc__gen_array(p, sizeof(size_t), I3IPC_ALIGNOF(size_t), &i3ipc__gen_sizet_el, obj ? &arr : NULL, &arr_size)) return 3;
+            if (obj) obj->focus = (size_t*)arr;
+            if (obj) obj->focus_size = arr_size;
+        } break;
+        case 34: { /* fullscreen_mode */
+            if (i3ipc__gen_int(p, obj ? &obj->fullscreen_mode : NULL)) return 3;
+        } break;
+        case 35: { /* nodes */
+            char* arr;
+            int arr_size = 0;
+            if (i3ipc__gen_array(p, sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node), &i3ipc__gen_node, obj ? &arr : NULL, &arr_size)) return 3;
+            if (obj) obj->nodes = (I3ipc_node*)arr;
+            if (obj) obj->nodes_size = arr_size;
+        } break;
+        case 37: { /* floating_nodes */
+            char* arr;
+            int arr_size = 0;
+            if (i3ipc__gen_array(p, sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node), &i3ipc__gen_node, obj ? &arr : NULL, &arr_size)) return 3;
+            if (obj) obj->floating_nodes = (I3ipc_node*)arr;
+            if (obj) obj->floating_nodes_size = arr_size;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_bar_config_colors(I3ipc_parse_state* p, char* base) {
+    I3ipc_bar_config_colors* obj = (I3ipc_bar_config_colors*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_BAR_CONFIG_COLORS];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_BAR_CONFIG_COLORS], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* background */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->background = str;
+                obj->background_size = str_size;
+            }
+        } break;
+        case 2: { /* statusline */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->statusline = str;
+                obj->statusline_size = str_size;
+            }
+        } break;
+        case 4: { /* separator */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->separator = str;
+                obj->separator_size = str_size;
+            }
+        } break;
+        case 6: { /* focused_background */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_background = str;
+                obj->focused_background_size = str_size;
+            }
+        } break;
+        case 8: { /* focused_statusline */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_statusline = str;
+                obj->focused_statusline_size = str_size;
+            }
+        } break;
+        case 10: { /* focused_separator */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_separator = str;
+                obj->focused_separator_size = str_size;
+            }
+        } break;
+        case 12: { /* focused_workspace_text */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_workspace_text = str;
+                obj->focused_workspace_text_size = str_size;
+            }
+        } break;
+        case 14: { /* focused_workspace_bg */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_workspace_bg = str;
+                obj->focused_workspace_bg_size = str_size;
+            }
+        } break;
+        case 16: { /* focused_workspace_border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->focused_workspace_border = str;
+                obj->focused_workspace_border_size = str_size;
+            }
+        } break;
+        case 18: { /* active_workspace_text */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->active_workspace_text = str;
+                obj->active_workspace_text_size = str_size;
+            }
+        } break;
+        case 20: { /* active_workspace_bg */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->active_workspace_bg = str;
+                obj->active_workspace_bg_size = str_size;
+            }
+        } break;
+        case 22: { /* active_workspace_border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->active_workspace_border = str;
+                obj->active_workspace_border_size = str_size;
+            }
+        } break;
+        case 24: { /* inactive_workspace_text */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->inactive_workspace_text = str;
+                obj->inactive_workspace_text_size = str_size;
+            }
+        } break;
+        case 26: { /* inactive_workspace_bg */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->inactive_workspace_bg = str;
+                obj->inactive_workspace_bg_size = str_size;
+            }
+        } break;
+        case 28: { /* inactive_workspace_border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->inactive_workspace_border = str;
+                obj->inactive_workspace_border_size = str_size;
+            }
+        } break;
+        case 30: { /* urgent_workspace_text */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->urgent_workspace_text = str;
+                obj->urgent_workspace_text_size = str_size;
+            }
+        } break;
+        case 32: { /* urgent_workspace_bg */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->urgent_workspace_bg = str;
+                obj->urgent_workspace_bg_size = str_size;
+            }
+        } break;
+        case 34: { /* urgent_workspace_border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->urgent_workspace_border = str;
+                obj->urgent_workspace_border_size = str_size;
+            }
+        } break;
+        case 36: { /* binding_mode_text */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->binding_mode_text = str;
+                obj->binding_mode_text_size = str_size;
+            }
+        } break;
+        case 38: { /* binding_mode_bg */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->binding_mode_bg = str;
+                obj->binding_mode_bg_size = str_size;
+            }
+        } break;
+        case 40: { /* binding_mode_border */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->binding_mode_border = str;
+                obj->binding_mode_border_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_bar_config(I3ipc_parse_state* p, char* base) {
+    I3ipc_bar_config* obj = (I3ipc_bar_config*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_BAR_CONFIG];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_BAR_CONFIG], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* id */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->id = str;
+                obj->id_size = str_size;
+            }
+        } break;
+        case 2: { /* mode */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->mode = str;
+                obj->mode_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_BAR_CONFIG].fields[4].enum_table;
+                if (table) obj->mode_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 5: { /* position */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->position = str;
+                obj->position_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_BAR_CONFIG].fields[7].enum_table;
+                if (table) obj->position_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 8: { /* status_command */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->status_command = str;
+                obj->status_command_size = str_size;
+            }
+        } break;
+        case 10: { /* font */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->font = str;
+                obj->font_size = str_size;
+            }
+        } break;
+        case 12: { /* workspace_buttons */
+            if (i3ipc__gen_bool(p, obj ? &obj->workspace_buttons : NULL)) return 3;
+        } break;
+        case 13: { /* binding_mode_indicator */
+            if (i3ipc__gen_bool(p, obj ? &obj->binding_mode_indicator : NULL)) return 3;
+        } break;
+        case 14: { /* verbose */
+            if (i3ipc__gen_bool(p, obj ? &obj->verbose : NULL)) return 3;
+        } break;
+        case 15: { /* colors */
+            if (i3ipc__gen_bar_config_colors(p, obj ? (char*)&obj->colors : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_command_el(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_command_el* obj = (I3ipc_reply_command_el*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_COMMAND_EL];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_COMMAND_EL], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* success */
+            if (i3ipc__gen_bool(p, obj ? &obj->success : NULL)) return 3;
+        } break;
+        case 1: { /* error */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->error = str;
+                obj->error_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_command(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_command* obj = (I3ipc_reply_command*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_reply_command_el), I3IPC_ALIGNOF(I3ipc_reply_command_el), &i3ipc__gen_reply_command_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->commands = (I3ipc_reply_command_el*)arr;
+        if (obj) obj->commands_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_workspaces_el(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_workspaces_el* obj = (I3ipc_reply_workspaces_el*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_WORKSPACES_EL];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_WORKSPACES_EL], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* id */
+            if (i3ipc__gen_sizet(p, obj ? &obj->id : NULL)) return 3;
+        } break;
+        case 1: { /* num */
+            if (i3ipc__gen_int(p, obj ? &obj->num : NULL)) return 3;
+        } break;
+        case 2: { /* name */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->name = str;
+                obj->name_size = str_size;
+            }
+        } break;
+        case 4: { /* visible */
+            if (i3ipc__gen_bool(p, obj ? &obj->visible : NULL)) return 3;
+        } break;
+        case 5: { /* focused */
+            if (i3ipc__gen_bool(p, obj ? &obj->focused : NULL)) return 3;
+        } break;
+        case 6: { /* urgent */
+            if (i3ipc__gen_bool(p, obj ? &obj->urgent : NULL)) return 3;
+        } break;
+        case 7: { /* rect */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->rect : NULL)) return 3;
+        } break;
+        case 8: { /* output */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->output = str;
+                obj->output_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_workspaces(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_workspaces* obj = (I3ipc_reply_workspaces*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_reply_workspaces_el), I3IPC_ALIGNOF(I3ipc_reply_workspaces_el), &i3ipc__gen_reply_workspaces_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->workspaces = (I3ipc_reply_workspaces_el*)arr;
+        if (obj) obj->workspaces_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_subscribe(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_subscribe* obj = (I3ipc_reply_subscribe*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_SUBSCRIBE];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_SUBSCRIBE], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* success */
+            if (i3ipc__gen_bool(p, obj ? &obj->success : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_outputs_el(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_outputs_el* obj = (I3ipc_reply_outputs_el*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_OUTPUTS_EL];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_OUTPUTS_EL], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* name */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->name = str;
+                obj->name_size = str_size;
+            }
+        } break;
+        case 2: { /* active */
+            if (i3ipc__gen_bool(p, obj ? &obj->active : NULL)) return 3;
+        } break;
+        case 3: { /* primary */
+            if (i3ipc__gen_bool(p, obj ? &obj->primary : NULL)) return 3;
+        } break;
+        case 4: { /* current_workspace */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->current_workspace = str;
+                obj->current_workspace_size = str_size;
+            }
+        } break;
+        case 6: { /* rect */
+            if (i3ipc__gen_rect(p, obj ? (char*)&obj->rect : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_outputs(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_outputs* obj = (I3ipc_reply_outputs*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_reply_outputs_el), I3IPC_ALIGNOF(I3ipc_reply_outputs_el), &i3ipc__gen_reply_outputs_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->outputs = (I3ipc_reply_outputs_el*)arr;
+        if (obj) obj->outputs_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_tree(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_tree* obj = (I3ipc_reply_tree*)base;
+    {
+        if (i3ipc__gen_node(p, obj ? (char*)&obj->root : NULL)) return 3;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_marks(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_marks* obj = (I3ipc_reply_marks*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_string), I3IPC_ALIGNOF(I3ipc_string), &i3ipc__gen_string_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->marks = (I3ipc_string*)arr;
+        if (obj) obj->marks_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_bar_config_ids(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_bar_config_ids* obj = (I3ipc_reply_bar_config_ids*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_string), I3IPC_ALIGNOF(I3ipc_string), &i3ipc__gen_string_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->ids = (I3ipc_string*)arr;
+        if (obj) obj->ids_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_bar_config(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_bar_config* obj = (I3ipc_reply_bar_config*)base;
+    {
+        if (i3ipc__gen_bar_config(p, obj ? (char*)&obj->cfg : NULL)) return 3;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_version(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_version* obj = (I3ipc_reply_version*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_VERSION];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_VERSION], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* major */
+            if (i3ipc__gen_int(p, obj ? &obj->major : NULL)) return 3;
+        } break;
+        case 1: { /* minor */
+            if (i3ipc__gen_int(p, obj ? &obj->minor : NULL)) return 3;
+        } break;
+        case 2: { /* patch */
+            if (i3ipc__gen_int(p, obj ? &obj->patch : NULL)) return 3;
+        } break;
+        case 3: { /* human_readable */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->human_readable = str;
+                obj->human_readable_size = str_size;
+            }
+        } break;
+        case 5: { /* loaded_config_file_name */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->loaded_config_file_name = str;
+                obj->loaded_config_file_name_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_binding_modes(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_binding_modes* obj = (I3ipc_reply_binding_modes*)base;
+    {
+        char* arr;
+        int arr_size = 0;
+        if (i3ipc__gen_array(p, sizeof(I3ipc_string), I3IPC_ALIGNOF(I3ipc_string), &i3ipc__gen_string_el, obj ? &arr : NULL, &arr_size)) return 3;
+        if (obj) obj->modes = (I3ipc_string*)arr;
+        if (obj) obj->modes_size = arr_size;
+    }
+    return 0;
+}
+
+int i3ipc__gen_reply_config(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_config* obj = (I3ipc_reply_config*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_CONFIG];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_CONFIG], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* config */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->config = str;
+                obj->config_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_tick(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_tick* obj = (I3ipc_reply_tick*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_TICK];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_TICK], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* success */
+            if (i3ipc__gen_bool(p, obj ? &obj->success : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_reply_sync(I3ipc_parse_state* p, char* base) {
+    I3ipc_reply_sync* obj = (I3ipc_reply_sync*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_REPLY_SYNC];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_REPLY_SYNC], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* success */
+            if (i3ipc__gen_bool(p, obj ? &obj->success : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_workspace(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_workspace* obj = (I3ipc_event_workspace*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_WORKSPACE];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_WORKSPACE], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_WORKSPACE].fields[2].enum_table;
+                if (table) obj->change_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 3: { /* current */
+            if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {
+                char* ptr = i3ipc__parse_alloc(p, sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node), NULL);
+                if (obj) obj->current = (I3ipc_node*)ptr;
+                if (i3ipc__gen_node(p, ptr)) return 3;
+            }
+        } break;
+        case 4: { /* old */
+            if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {
+                char* ptr = i3ipc__parse_alloc(p, sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node), NULL);
+                if (obj) obj->old = (I3ipc_node*)ptr;
+                if (i3ipc__gen_node(p, ptr)) return 3;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_output(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_output* obj = (I3ipc_event_output*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_OUTPUT];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_OUTPUT], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_OUTPUT].fields[2].enum_table;
+                if (table) obj->change_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_mode(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_mode* obj = (I3ipc_event_mode*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_MODE];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_MODE], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+            }
+        } break;
+        case 2: { /* pango_markup */
+            if (i3ipc__gen_bool(p, obj ? &obj->pango_markup : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_window(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_window* obj = (I3ipc_event_window*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_WINDOW];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_WINDOW], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_WINDOW].fields[2].enum_table;
+                if (table) obj->change_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 3: { /* container */
+            if (i3ipc__gen_node(p, obj ? (char*)&obj->container : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_barconfig_update(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_barconfig_update* obj = (I3ipc_event_barconfig_update*)base;
+    {
+        if (i3ipc__gen_bar_config(p, obj ? (char*)&obj->cfg : NULL)) return 3;
+    }
+    return 0;
+}
+
+int i3ipc__gen_event_binding_binding(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_binding_binding* obj = (I3ipc_event_binding_binding*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_BINDING_BINDING];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_BINDING_BINDING], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* command */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->command = str;
+                obj->command_size = str_size;
+            }
+        } break;
+        case 2: { /* event_state_mask */
+            char* arr;
+            int arr_size = 0;
+            if (i3ipc__gen_array(p, sizeof(I3ipc_string), I3IPC_ALIGNOF(I3ipc_string), &i3ipc__gen_string_el, obj ? &arr : NULL, &arr_size)) return 3;
+            if (obj) obj->event_state_mask = (I3ipc_string*)arr;
+            if (obj) obj->event_state_mask_size = arr_size;
+        } break;
+        case 4: { /* input_code */
+            if (i3ipc__gen_int(p, obj ? &obj->input_code : NULL)) return 3;
+        } break;
+        case 5: { /* symbol */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, true, &str, &str_size)) return 3;
+            if (obj) {
+                obj->symbol = str;
+                obj->symbol_size = str_size;
+            }
+        } break;
+        case 7: { /* input_type */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->input_type = str;
+                obj->input_type_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_BINDING_BINDING].fields[9].enum_table;
+                if (table) obj->input_type_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_binding(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_binding* obj = (I3ipc_event_binding*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_BINDING];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_BINDING], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_BINDING].fields[2].enum_table;
+                if (table) obj->change_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        case 3: { /* binding */
+            if (i3ipc__gen_event_binding_binding(p, obj ? (char*)&obj->binding : NULL)) return 3;
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_shutdown(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_shutdown* obj = (I3ipc_event_shutdown*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_SHUTDOWN];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_SHUTDOWN], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* change */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->change = str;
+                obj->change_size = str_size;
+                I3ipc_enum_table* table = i3ipc__global_types[I3IPC_TYPE_EVENT_SHUTDOWN].fields[2].enum_table;
+                if (table) obj->change_enum = i3ipc__enum_lookup(table, str, str_size);
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+int i3ipc__gen_event_tick(I3ipc_parse_state* p, char* base) {
+    I3ipc_event_tick* obj = (I3ipc_event_tick*)base;
+    uint64_t skip = p->context->projection_skip[I3IPC_TYPE_EVENT_TICK];
+    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[I3IPC_TYPE_EVENT_TICK], &field);) {
+        if (skip >> field & 1) {
+            if (i3ipc__json_skip(&p->state)) return 3;
+            continue;
+        }
+        switch (field) {
+        case 0: { /* first */
+            if (i3ipc__gen_bool(p, obj ? &obj->first : NULL)) return 3;
+        } break;
+        case 1: { /* payload */
+            char* str;
+            int str_size;
+            if (i3ipc__gen_string(p, false, &str, &str_size)) return 3;
+            if (obj) {
+                obj->payload = str;
+                obj->payload_size = str_size;
+            }
+        } break;
+        default: assert(false);
+        }
+    }
+    if (p->state.err_flag) return 9;
+    return 0;
+}
+
+/* Return the generated parser for type_id, or NULL if there is none */
+I3ipc_gen_parse i3ipc__gen_parser(int type_id) {
+    switch (type_id) {
+    case I3IPC_TYPE_RECT: return &i3ipc__gen_rect;
+    case I3IPC_TYPE_NODE_WINDOW_PROPERTIES: return &i3ipc__gen_node_window_properties;
+    case I3IPC_TYPE_NODE: return &i3ipc__gen_node;
+    case I3IPC_TYPE_BAR_CONFIG_COLORS: return &i3ipc__gen_bar_config_colors;
+    case I3IPC_TYPE_BAR_CONFIG: return &i3ipc__gen_bar_config;
+    case I3IPC_TYPE_REPLY_COMMAND_EL: return &i3ipc__gen_reply_command_el;
+    case I3IPC_TYPE_REPLY_COMMAND: return &i3ipc__gen_reply_command;
+    case I3IPC_TYPE_REPLY_WORKSPACES_EL: return &i3ipc__gen_reply_workspaces_el;
+    case I3IPC_TYPE_REPLY_WORKSPACES: return &i3ipc__gen_reply_workspaces;
+    case I3IPC_TYPE_REPLY_SUBSCRIBE: return &i3ipc__gen_reply_subscribe;
+    case I3IPC_TYPE_REPLY_OUTPUTS_EL: return &i3ipc__gen_reply_outputs_el;
+    case I3IPC_TYPE_REPLY_OUTPUTS: return &i3ipc__gen_reply_outputs;
+    case I3IPC_TYPE_REPLY_TREE: return &i3ipc__gen_reply_tree;
+    case I3IPC_TYPE_REPLY_MARKS: return &i3ipc__gen_reply_marks;
+    case I3IPC_TYPE_REPLY_BAR_CONFIG_IDS: return &i3ipc__gen_reply_bar_config_ids;
+    case I3IPC_TYPE_REPLY_BAR_CONFIG: return &i3ipc__gen_reply_bar_config;
+    case I3IPC_TYPE_REPLY_VERSION: return &i3ipc__gen_reply_version;
+    case I3IPC_TYPE_REPLY_BINDING_MODES: return &i3ipc__gen_reply_binding_modes;
+    case I3IPC_TYPE_REPLY_CONFIG: return &i3ipc__gen_reply_config;
+    case I3IPC_TYPE_REPLY_TICK: return &i3ipc__gen_reply_tick;
+    case I3IPC_TYPE_REPLY_SYNC: return &i3ipc__gen_reply_sync;
+    case I3IPC_TYPE_EVENT_WORKSPACE: return &i3ipc__gen_event_workspace;
+    case I3IPC_TYPE_EVENT_OUTPUT: return &i3ipc__gen_event_output;
+    case I3IPC_TYPE_EVENT_MODE: return &i3ipc__gen_event_mode;
+    case I3IPC_TYPE_EVENT_WINDOW: return &i3ipc__gen_event_window;
+    case I3IPC_TYPE_EVENT_BARCONFIG_UPDATE: return &i3ipc__gen_event_barconfig_update;
+    case I3IPC_TYPE_EVENT_BINDING_BINDING: return &i3ipc__gen_event_binding_binding;
+    case I3IPC_TYPE_EVENT_BINDING: return &i3ipc__gen_event_binding;
+    case I3IPC_TYPE_EVENT_SHUTDOWN: return &i3ipc__gen_event_shutdown;
+    case I3IPC_TYPE_EVENT_TICK: return &i3ipc__gen_event_tick;
+    default: return NULL;
+    }
+}
+
+#endif /* I3IPC_GENERATED_PARSERS */
+/* End of generated parsers */
 
 int i3ipc__parse_helper(I3ipc_parse_state* p, int type_id, int type_flags, char* base) {
     assert(p);
     assert(type_id != I3IPC_TYPE_EVENT);
 
+#if I3IPC_GENERATED_PARSERS
+    if (type_flags == 0 && !p->lazy_tree && !p->context->debug_interpret) {
+        I3ipc_gen_parse gen_parse = i3ipc__gen_parser(type_id);
+        if (gen_parse) {
+            if (gen_parse(p, base)) return 18;
+            p->next_set = true;
+            p->next_enum = NULL;
+            return 0;
+        }
+    }
+#endif
+
     bool is_string_type = (type_id == I3IPC_TYPE_STRING && type_flags == 0)
         || (type_id == I3IPC_TYPE_CHAR && (type_flags & I3IPC_TYPE_ISARRAY));
     bool was_set = true;
@@ -2381,16 +5819,7 @@ int i3ipc__parse_helper(I3ipc_parse_state* p, int type_id, int type_flags, char*
         I3ipc_json_token tok;
         if (i3ipc__json_match(&p->state, I3IPC_JSON_STRING, &tok)) return 1;
 
-        char* str_base;
-        if (p->copy_strings) {
-            str_base = i3ipc__parse_alloc(p, tok.str_size + 1, 1, NULL);
-            if (base) {
-                memcpy(str_base, tok.str, tok.str_size + 1);
-            }
-        } else {
-            str_base = tok.str;
-        }
-        
+        char* str_base = i3ipc__parse_string(p, tok);
         if (base) {
             if (type_id == I3IPC_TYPE_STRING) {
                 *(char**)(base + type.fields[0].offset) = str_base;
@@ -2401,6 +5830,38 @@ int i3ipc__parse_helper(I3ipc_parse_state* p, int type_id, int type_flags, char*
             }
             was_enum = str_base;
         }
+    } else if ((type_flags & I3IPC_TYPE_ISARRAY) && p->arena) {
+        /* The size is not known in advance. Each element is parsed into a temporary, which is then
+         * appended to the array, growing it as needed. */
+        assert(base);
+        char* elem = (char*)alloca(type.size + type.alignment);
+        elem += -(size_t)elem & (type.alignment-1);
+        
+        char* arr_base = NULL;
+        int arr_capacity = 0;
+        int i;
+        for (i = 0; i3ipc__json_looparr(&p->state, &i); ++i) {
+            memset(elem, 0, type.size);
+            if (i3ipc__parse_helper(p, type_id, 0, elem)) return 6;
+
+            if (i == arr_capacity) {
+                arr_capacity = arr_capacity ? 2 * arr_capacity : 4;
+                char* arr_next = i3ipc__arena_alloc(p->arena, arr_capacity * type.size, type.alignment);
+                if (i) memcpy(arr_next, arr_base, i * type.size);
+                arr_base = arr_next;
+            }
+            memcpy(arr_base + i * type.size, elem, type.size);
+        }
+        if (p->state.err_flag) return 9;
+
+        if (arr_base) {
+            i3ipc__arena_shrink(p->arena, arr_base, arr_capacity * type.size, i * type.size);
+        } else {
+            arr_base = i3ipc__arena_alloc(p->arena, 0, type.alignment);
+        }
+        p->live_size += i * type.size + type.alignment-1;
+        *(char**)base = arr_base;
+        p->next_size = i;
     } else if (type_flags & I3IPC_TYPE_ISARRAY) {
         int index;
         char* arr_base = i3ipc__parse_alloc(p, -1, type.alignment, &index);
@@ -2432,14 +5893,24 @@ int i3ipc__parse_helper(I3ipc_parse_state* p, int type_id, int type_flags, char*
         switch (base ? type_id : -1) {
         case -1: break;
         case I3IPC_TYPE_BOOL:  *(bool*)base = tok.flag; break;
-        case I3IPC_TYPE_SIZET: *(size_t*)base = tok.number_long; break;
-        case I3IPC_TYPE_INT:   *(int*)base = (int)tok.number_long; break;
-        case I3IPC_TYPE_FLOAT: *(float*)base = (float)tok.number; break;
-        /* case I3IPC_TYPE_CHAR:  *base = (char)tok.number_long; break; */
+        case I3IPC_TYPE_SIZET: *(size_t*)base = i3ipc__json_number_int(tok.num, tok.num_size); break;
+        case I3IPC_TYPE_INT:   *(int*)base = (int)i3ipc__json_number_int(tok.num, tok.num_size); break;
+        case I3IPC_TYPE_FLOAT: *(float*)base = (float)i3ipc__json_number_float(tok.num, tok.num_size); break;
+        /* case I3IPC_TYPE_CHAR:  *base = (char)i3ipc__json_number_int(tok.num, tok.num_size); break; */
         default: assert(false);
         }
+    } else if (type_flags == 0 && type_id == I3IPC_TYPE_NODE && i3ipc__parse_parallel_ready(p)) {
+        if (i3ipc__parse_parallel_take(p, base)) return 3;
     } else if (type_flags == 0) {
+        I3ipc_lazy_record* lazy_record = type_id == I3IPC_TYPE_NODE ? p->lazy_record : NULL;
+        uint64_t skip = p->context->projection_skip[type_id];
         for (int field = -1; i3ipc__parse_loopfields(&p->state, &type, &field);) {
+            if (skip >> field & 1) {
+                if (i3ipc__json_skip(&p->state)) return 3;
+                continue;
+            }
+            if (lazy_record && i3ipc__parse_lazy_skip(p, lazy_record, type.fields[field].offset)) continue;
+            
             char* field_base = base ? base + type.fields[field].offset : NULL;
             if (i3ipc__parse_helper(
                 p, type.fields[field].type, type.fields[field].flags, field_base
@@ -2457,7 +5928,401 @@ int i3ipc__parse_helper(I3ipc_parse_state* p, int type_id, int type_flags, char*
     return 0;
 }
 
-int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** out_data) {
+typedef struct I3ipc_compact {
+    char* memory; /* where the next allocation goes */
+    
+    /* If not NULL, equal strings are copied only once, and strings in the pool of
+     * I3IPC_PARSE_INTERN_POOL stay there */
+    I3ipc_intern* intern;
+
+    /* If not NULL, strings point into json, they are moved into json_copy instead of being copied */
+    char* json;
+    char* json_copy;
+    int json_size;
+
+    /* If not NULL, memory is taken from arena instead */
+    I3ipc_arena* arena;
+} I3ipc_compact;
+
+/* The object at base has been copied, now copy everything it references into memory taken from
+ * c and update the pointers. size is the size of arrays. */
+void i3ipc__parse_compact_helper(int type_id, int type_flags, char* base, int size, I3ipc_compact* c) {
+    bool is_string_type = (type_id == I3IPC_TYPE_STRING && type_flags == 0)
+        || (type_id == I3IPC_TYPE_CHAR && (type_flags & I3IPC_TYPE_ISARRAY));
+    
+    I3ipc_type type = i3ipc__type_get(type_id);
+    size_t alignment = is_string_type ? 1 : type.alignment;
+    char** ptr = (char**)(type_id == I3IPC_TYPE_STRING && type_flags == 0 ? base + type.fields[0].offset : base);
+    if (type_flags & (I3IPC_TYPE_ISPTR | I3IPC_TYPE_ISARRAY) || is_string_type) {
+        if (!*ptr) return; /* a field that was not set */
+        
+        size_t ptr_size;
+        if (type_flags & I3IPC_TYPE_ISPTR) {
+            ptr_size = type.size;
+        } else if (is_string_type) {
+            if (type_id == I3IPC_TYPE_STRING) size = *(int*)(base + type.fields[1].offset);
+            ptr_size = size + 1; /* zero-terminated */
+        } else {
+            ptr_size = size * type.size;
+        }
+
+        if (is_string_type && c->json_copy) {
+            assert(c->json <= *ptr && *ptr + ptr_size <= c->json + c->json_size + 1);
+            *ptr = c->json_copy + (*ptr - c->json);
+            return;
+        }
+        
+        I3ipc_intern_entry* entry = NULL;
+        if (is_string_type && c->intern && ptr_size - 1 <= I3IPC__INTERN_MAX_SIZE) {
+            I3ipc_intern_entry* pooled = i3ipc__intern_find(&i3ipc__global_context.intern_pool,
+                *ptr, ptr_size - 1, false, NULL);
+            if (pooled && pooled->copy == *ptr) return;
+            
+            entry = i3ipc__intern_find(c->intern, *ptr, ptr_size - 1, true, NULL);
+            if (entry->moved) {
+                *ptr = entry->moved;
+                return;
+            }
+        }
+
+        if (c->arena) {
+            char* copy = i3ipc__arena_alloc(c->arena, ptr_size, alignment);
+            memcpy(copy, *ptr, ptr_size);
+            *ptr = copy;
+        } else {
+            c->memory += -(size_t)c->memory & (alignment-1);
+            memcpy(c->memory, *ptr, ptr_size);
+            *ptr = c->memory;
+            c->memory += ptr_size;
+        }
+        if (entry) entry->moved = *ptr;
+    }
+    
+    if (type_flags & I3IPC_TYPE_ISPTR) {
+        i3ipc__parse_compact_helper(type_id, type_flags & ~I3IPC_TYPE_GROUP_MAYBE, *ptr, -1, c);
+    } else if (is_string_type) {
+        /* nothing else to do */
+    } else if (type_flags & I3IPC_TYPE_ISARRAY) {
+        for (int i = 0; i < size; ++i) {
+            i3ipc__parse_compact_helper(type_id, 0, *ptr + i * type.size, -1, c);
+        }
+    } else if (type.is_inline) {
+        int i_size = -1;
+        i3ipc__type_readderived(&type, 0, base, NULL, &i_size, NULL);
+        I3ipc_field field = type.fields[0];
+        i3ipc__parse_compact_helper(field.type, field.flags, base + field.offset, i_size, c);
+    } else if (!type.is_primitive) {
+        for (int i = 0; i < type.fields_size; ++i) {
+            I3ipc_field field = type.fields[i];
+            if (field.flags & I3IPC_TYPE_GROUP_DERIVED) continue;
+            
+            int i_size = -1;
+            i3ipc__type_readderived(&type, i, base, NULL, &i_size, NULL);
+            i3ipc__parse_compact_helper(field.type, field.flags & ~I3IPC_TYPE_ISOPT,
+                base + field.offset, i_size, c);
+        }
+    }
+}
+
+uint64_t i3ipc_projection_mask(int type_id, char const* fields) {
+    assert(0 <= type_id && type_id < I3IPC_TYPE_COUNT && fields);
+    if (!i3ipc__globals_initialized) {
+        i3ipc__init_globals();        
+    }
+
+    I3ipc_type type = i3ipc__type_get(type_id);
+    uint64_t mask = 0;
+    while (*fields) {
+        if (*fields == ' ') { ++fields; continue; }
+        int name_size = 0;
+        while (fields[name_size] && fields[name_size] != ' ') ++name_size;
+
+        int i;
+        for (i = 0; i < type.fields_size; ++i) {
+            I3ipc_field f = type.fields[i];
+            if (f.flags & I3IPC_TYPE_GROUP_DERIVED) continue;
+            if (f.json_name_size == name_size && memcmp(f.json_name, fields, name_size) == 0) break;
+        }
+        if (i == type.fields_size) {
+            fprintf(i3ipc__err, "unknown member '%.*s' of %s\n", name_size, fields, type.name);
+            i3ipc__error_handle(I3IPC_ERROR_FAILED);
+        } else {
+            mask |= (uint64_t)1 << i;
+        }
+        fields += name_size;
+    }
+    return mask;
+}
+
+/* Smaller messages are parsed on a single thread, as starting the others would take longer */
+#define I3IPC__PARALLEL_MIN_TOKENS 8192
+#define I3IPC__PARALLEL_TASKS_MAX 256
+#define I3IPC__PARALLEL_THREADS_MAX 64
+
+/* Return the tape index of the value of member name of the object at index, or -1 if there is none.
+ * The object must have been validated by i3ipc__json_scan_feed. */
+int i3ipc__tape_member(I3ipc_json_state* state, int index, char const* name) {
+    assert(I3IPC__TAPE_TYPE(state->tape[index]) == '{' && i3ipc__tape_match(state->tape[index]) != -1);
+    int name_size = (int)strlen(name);
+    int i = index + 1;
+    while (I3IPC__TAPE_TYPE(state->tape[i]) == I3IPC_JSON_STRING) {
+        I3ipc_json_token key;
+        i3ipc__tape_unpack(state->tape[i], state->tape_json, &key);
+        int value = i + 2; /* after the ':' */
+        if (key.str_size == name_size && memcmp(key.str, name, name_size) == 0) return value;
+
+        int value_type = I3IPC__TAPE_TYPE(state->tape[value]);
+        i = value_type == '{' || value_type == '[' ? i3ipc__tape_match(state->tape[value]) + 1 : value + 1;
+        if (I3IPC__TAPE_TYPE(state->tape[i]) == ',') ++i;
+    }
+    return -1;
+}
+
+/* Replace the task at index with the children of its node, which are inserted in tape order. Return
+ * the number of children, tasks must have space for all of them. */
+int i3ipc__parallel_split_task(I3ipc_json_state* state, I3ipc_parallel_task* tasks, int tasks_size, int index) {
+    int pos = index == -1 ? 0 : tasks[index].pos;
+    int arr = i3ipc__tape_member(state, pos, "nodes");
+    if (arr == -1 || I3IPC__TAPE_TYPE(state->tape[arr]) != '[') return 0;
+
+    int children[I3IPC__PARALLEL_TASKS_MAX];
+    int children_size = 0;
+    int i = arr + 1;
+    while (I3IPC__TAPE_TYPE(state->tape[i]) != ']') {
+        int type = I3IPC__TAPE_TYPE(state->tape[i]);
+        /* Anything else is left to the parser, which reports the error */
+        if (type == '{') {
+            if (tasks_size - (index != -1) + children_size >= I3IPC__PARALLEL_TASKS_MAX) return 0;
+            children[children_size++] = i;
+        }
+        i = type == '{' || type == '[' ? i3ipc__tape_match(state->tape[i]) + 1 : i + 1;
+        if (I3IPC__TAPE_TYPE(state->tape[i]) == ',') ++i;
+    }
+    if (index != -1 && children_size == 0) return 0;
+
+    /* Make room for the children in place of the task */
+    int first = index == -1 ? 0 : index;
+    int rest = index == -1 ? 0 : index + 1;
+    memmove(tasks + first + children_size, tasks + rest, (tasks_size - rest) * sizeof(tasks[0]));
+    for (int j = 0; j < children_size; ++j) {
+        memset(&tasks[first + j], 0, sizeof(tasks[0]));
+        tasks[first + j].pos = children[j];
+    }
+    return children_size;
+}
+
+typedef struct I3ipc_parallel {
+    I3ipc_context* context;
+    I3ipc_json_state* state; /* the scanned json, only read by the workers */
+    bool copy_strings;
+    I3ipc_parallel_task* tasks;
+    int tasks_size;
+    int tasks_next;
+#if I3IPC_THREADS
+    pthread_mutex_t mutex;
+#endif
+} I3ipc_parallel;
+
+typedef struct I3ipc_parallel_worker {
+    I3ipc_parallel* parallel;
+    I3ipc_arena* arena;
+    size_t live_size;
+} I3ipc_parallel_worker;
+
+/* Parse tasks until none are left. Each worker allocates from its own arena. */
+void* i3ipc__parallel_worker(void* arg) {
+    I3ipc_parallel_worker* worker = (I3ipc_parallel_worker*)arg;
+    I3ipc_parallel* par = worker->parallel;
+
+    I3ipc_parse_state p;
+    memset(&p, 0, sizeof(p));
+    p.context = par->context;
+    p.arena = worker->arena;
+    p.copy_strings = par->copy_strings;
+    while (true) {
+#if I3IPC_THREADS
+        pthread_mutex_lock(&par->mutex);
+#endif
+        int i = par->tasks_next++;
+#if I3IPC_THREADS
+        pthread_mutex_unlock(&par->mutex);
+#endif
+        if (i >= par->tasks_size) break;
+
+        I3ipc_parallel_task* task = &par->tasks[i];
+        p.state = *par->state;
+        p.state.tape_cur = task->pos;
+        p.state.tape_window_size = 0;
+        task->code = i3ipc__parse_helper(&p, I3IPC_TYPE_NODE, 0, (char*)&task->node);
+    }
+    worker->live_size = p.live_size;
+    return NULL;
+}
+
+/* Split the GET_TREE reply on the tape of p into subtrees, and parse them on multiple threads. If
+ * this is worthwhile, p is set up so that i3ipc__parse_helper uses the results, instead of parsing
+ * the subtrees again. The root node and the large ones below it are split into their children,
+ * until every subtree is small enough that the threads can be kept busy. */
+void i3ipc__parallel_parse(I3ipc_parse_state* p) {
+    I3ipc_context* context = p->context;
+    I3ipc_json_state* state = &p->state;
+    
+    int threads = context->parse_threads;
+#if I3IPC_THREADS
+    if (threads == 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    threads = 1;
+#endif
+    if (threads < 1) threads = 1;
+    if (threads > I3IPC__PARALLEL_THREADS_MAX) threads = I3IPC__PARALLEL_THREADS_MAX;
+    
+    if (threads == 1 && !context->debug_parallel_always) return;
+    if (state->tape_size < I3IPC__PARALLEL_MIN_TOKENS && !context->debug_parallel_always) return;
+    if (I3IPC__TAPE_TYPE(state->tape[0]) != '{' || i3ipc__tape_match(state->tape[0]) == -1) return;
+
+    I3ipc_parallel_task* tasks;
+    i3ipc__context_reserve(context, I3IPC_CONTEXT_PARALLEL,
+        I3IPC__PARALLEL_TASKS_MAX * sizeof(tasks[0]), (void**)&tasks);
+    int tasks_size = i3ipc__parallel_split_task(state, tasks, 0, -1);
+    while (tasks_size) {
+        int largest = 0;
+        for (int i = 1; i < tasks_size; ++i) {
+            if (i3ipc__tape_match(state->tape[tasks[i].pos]) - tasks[i].pos
+                > i3ipc__tape_match(state->tape[tasks[largest].pos]) - tasks[largest].pos) largest = i;
+        }
+        int span = i3ipc__tape_match(state->tape[tasks[largest].pos]) - tasks[largest].pos;
+        if (span * 2 * threads <= state->tape_size) break;
+        
+        int children_size = i3ipc__parallel_split_task(state, tasks, tasks_size, largest);
+        if (!children_size) break;
+        tasks_size += children_size - 1;
+    }
+    if (!tasks_size) return;
+
+    if (context->parallel_arenas_size < threads) {
+        context->parallel_arenas = (I3ipc_arena*)i3ipc__realloc(context->parallel_arenas, threads * sizeof(I3ipc_arena));
+        memset(context->parallel_arenas + context->parallel_arenas_size, 0,
+            (threads - context->parallel_arenas_size) * sizeof(I3ipc_arena));
+        context->parallel_arenas_size = threads;
+    }
+    
+    I3ipc_parallel par;
+    memset(&par, 0, sizeof(par));
+    par.context = context;
+    par.state = state;
+    par.copy_strings = p->copy_strings;
+    par.tasks = tasks;
+    par.tasks_size = tasks_size;
+
+    I3ipc_parallel_worker workers[I3IPC__PARALLEL_THREADS_MAX];
+    for (int i = 0; i < threads; ++i) {
+        workers[i].parallel = &par;
+        workers[i].arena = &context->parallel_arenas[i];
+        workers[i].live_size = 0;
+        i3ipc__arena_reset(workers[i].arena);
+    }
+    
+#if I3IPC_THREADS
+    /* The calling thread is the first worker. If a thread cannot be started, the others do its share. */
+    pthread_mutex_init(&par.mutex, NULL);
+    pthread_t handles[I3IPC__PARALLEL_THREADS_MAX];
+    int started = 1;
+    for (; started < threads && started < tasks_size; ++started) {
+        if (pthread_create(&handles[started], NULL, &i3ipc__parallel_worker, &workers[started])) break;
+    }
+    i3ipc__parallel_worker(&workers[0]);
+    for (int i = 1; i < started; ++i) {
+        pthread_join(handles[i], NULL);
+    }
+    pthread_mutex_destroy(&par.mutex);
+#else
+    i3ipc__parallel_worker(&workers[0]);
+#endif
+    
+    for (int i = 0; i < tasks_size; ++i) {
+        if (tasks[i].code) {
+            /* Parse everything again on this thread, so that the error is reported as usual */
+            i3ipc__error_clearbuf();
+            return;
+        }
+    }
+    for (int i = 0; i < threads; ++i) {
+        p->live_size += workers[i].live_size;
+    }
+    p->parallel_tasks = tasks;
+    p->parallel_size = tasks_size;
+    p->parallel_next = 0;
+}
+
+/* Return the json i3 usually sends as reply of type type_id, or NULL if there is no such thing. Almost
+ * all replies to commands are exactly this, so they are recognised without running the parser. */
+char const* i3ipc__success_json(int type_id, int* out_size) {
+    static char const success[] = "[{\"success\":true}]";
+    int size = sizeof(success) - 1;
+    switch (type_id) {
+    case I3IPC_TYPE_REPLY_COMMAND:
+        if (out_size) *out_size = size;
+        return success;
+    case I3IPC_TYPE_REPLY_SUBSCRIBE:
+    case I3IPC_TYPE_REPLY_TICK:
+    case I3IPC_TYPE_REPLY_SYNC:
+        if (out_size) *out_size = size - 2;
+        return success + 1;
+    default:
+        return NULL;
+    }
+}
+
+/* If msg is exactly the json returned by i3ipc__success_json, write the result for it into out_data
+ * and return true. Otherwise return false, and msg has to be parsed normally. */
+bool i3ipc__parse_success(I3ipc_message* msg, int type_id, char** out_data) {
+    int size;
+    char const* json = i3ipc__success_json(type_id, &size);
+    if (!json || msg->message_length != size || memcmp(msg + 1, json, size)) return false;
+
+    /* A projection may leave out the members that are set here, so the full parse decides */
+    I3ipc_context* context = &i3ipc__global_context;
+    if (context->projection_skip[type_id]) return false;
+    if (type_id == I3IPC_TYPE_REPLY_COMMAND && context->projection_skip[I3IPC_TYPE_REPLY_COMMAND_EL]) return false;
+    size_t align = I3IPC_ALIGNOF(I3ipc_reply_command_el);
+    size_t el_offset = (sizeof(I3ipc_reply_command) + align-1) & ~(align-1);
+    size_t total_size = type_id == I3IPC_TYPE_REPLY_COMMAND
+        ? el_offset + sizeof(I3ipc_reply_command_el) : sizeof(I3ipc_reply_tick);
+
+    /* Same as the result of the parser, so that it can be freed in the same way */
+    char* memory;
+    if (context->staticalloc) {
+        i3ipc__context_reserve(context, I3IPC_CONTEXT_PARSE, total_size, (void**)&memory);
+        memset(memory, 0, total_size);
+    } else {
+        memory = i3ipc__reply_alloc(context, total_size);
+        memset(memory, 0, total_size);
+    }
+
+    switch (type_id) {
+    case I3IPC_TYPE_REPLY_COMMAND: {
+        I3ipc_reply_command* reply = (I3ipc_reply_command*)memory;
+        reply->commands = (I3ipc_reply_command_el*)(memory + el_offset);
+        reply->commands_size = 1;
+        reply->commands[0].success = true;
+    } break;
+    case I3IPC_TYPE_REPLY_SUBSCRIBE: ((I3ipc_reply_subscribe*)memory)->success = true; break;
+    case I3IPC_TYPE_REPLY_TICK:      ((I3ipc_reply_tick*)     memory)->success = true; break;
+    case I3IPC_TYPE_REPLY_SYNC:      ((I3ipc_reply_sync*)     memory)->success = true; break;
+    default: assert(false);
+    }
+
+    if (out_data) *out_data = memory;
+    return true;
+}
+
+/* Parse msg, see i3ipc_parse_try. scanned may be the state of scanning msg while it arrived. If
+ * io_size is not NULL, the result is written into the *io_size bytes at into, see
+ * i3ipc_parse_into_try. If into is NULL, only the number of bytes needed is written to *io_size. */
+int i3ipc__parse_try(
+    I3ipc_message* msg, int message_type, int type_id, char** out_data, I3ipc_json_state* scanned,
+    char* into, size_t* io_size
+) {
     assert(msg);
     if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
     {int code = i3ipc_init_try(NULL);
@@ -2465,12 +6330,26 @@ int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** ou
 
     I3ipc_context* context = &i3ipc__global_context;
 
+    /* The result takes the current generation, see i3ipc_set_staticalloc_generations */
+    if (context->staticalloc && !io_size) {
+        i3ipc__generation_next(context, msg);
+        context->generation_used = true;
+    }
+
     /* Initialise parse state */
     I3ipc_parse_state p;
     memset(&p, 0, sizeof(p));
     p.context = context;
     p.allocs = (I3ipc_parse_state_allocs*)context->buffers[I3IPC_CONTEXT_ALLOCS];
-    p.copy_strings = !context->staticalloc;
+    /* The buffer of the caller gets everything, so the size has to be known before writing, and
+     * determining it must leave the json as it is */
+    bool sizeonly = io_size && !into;
+    /* Without modifying the json, strings have to be decoded into the result */
+    bool nondestructive = (context->parseflags & I3IPC_PARSE_NONDESTRUCTIVE) || sizeonly;
+    bool zerocopy = (context->parseflags & I3IPC_PARSE_ZEROCOPY) && !context->staticalloc && !nondestructive && !io_size;
+    p.copy_strings = (!context->staticalloc && !zerocopy) || nondestructive || io_size;
+    char* json = (char*)(msg + 1);
+    int json_size = msg->message_length;
 
     if (msg->message_type != message_type) {
         fprintf(i3ipc__err, "Unexpected reply type, expected %s(%x), got %s(%x)\n",
@@ -2478,19 +6357,85 @@ int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** ou
             i3ipc__message_type_str(msg->message_type, true), msg->message_type);
         return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
     }
+
+    if (!context->debug_interpret && !io_size && i3ipc__parse_success(msg, type_id, out_data)) return 0;
     
     memset(&p.state, 0, sizeof(p.state));
-    p.state.cur = (char*)(msg + 1);
-    p.state.left = msg->message_length;
-    p.state.tokens = (I3ipc_json_token*)context->buffers[I3IPC_CONTEXT_JSON];
-    if (i3ipc__json_scan(context, &p.state)) {
-        return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    /* Offsets on the tape are limited, larger messages are always streamed */
+    bool stream = (context->parseflags & I3IPC_PARSE_STREAM) || msg->message_length > I3IPC__TAPE_MAX;
+    bool parallel = (context->parseflags & I3IPC_PARSE_PARALLEL) && !stream && type_id == I3IPC_TYPE_REPLY_TREE && !io_size;
+    bool singlepass = ((context->parseflags & I3IPC_PARSE_SINGLEPASS) || parallel) && !io_size;
+    if (stream) {
+        /* Tokens are scanned when they are needed. The first pass must not modify the json, as it
+         * is scanned again during the second one. */
+        i3ipc__json_stream_begin(&p.state, (char*)(msg + 1), msg->message_length);
+        p.state.nomodify_flag = !singlepass || nondestructive;
+    } else if (scanned && scanned->scan_done && scanned->nomodify_flag == nondestructive) {
+        assert(scanned->tape_json == (char*)(msg + 1));
+        p.state = *scanned;
+        p.state.tape_cur = 0;
+        p.state.tape_window_size = 0;
+    } else {
+        p.state.cur = (char*)(msg + 1);
+        p.state.left = msg->message_length;
+        p.state.tape = (uint64_t*)context->buffers[I3IPC_CONTEXT_JSON];
+        if (i3ipc__json_scan(context, &p.state, nondestructive)) {
+            return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+        }
+    }
+
+    if (!nondestructive) {
+        msg->message_length = 0; /* Safety precaution, as we will change the contents */
     }
 
-    msg->message_length = 0; /* Safety precaution, as we will change the contents */
+    /* The two passes have to see the same strings, but the first one of a streaming parse sees them
+     * before they are decoded. The buffer of the caller must not reference the pool, and the size
+     * and the into call have to agree, so there is no interning for them. */
+    bool intern = (context->parseflags & (I3IPC_PARSE_INTERN | I3IPC_PARSE_INTERN_POOL))
+        && p.copy_strings && (singlepass || !stream || nondestructive) && !io_size;
+    if (intern) {
+        i3ipc__intern_reset(&context->intern);
+        p.intern = &context->intern;
+    }
 
-    /* Allocate space for the base type */
     I3ipc_type type = i3ipc__type_get(type_id);
+    if (singlepass) {
+        i3ipc__arena_reset(&context->arena);
+        p.arena = &context->arena;
+        if (parallel) i3ipc__parallel_parse(&p);
+        char* base = i3ipc__parse_alloc(&p, type.size, type.alignment, NULL);
+        
+        if (i3ipc__parse_helper(&p, type_id, 0, base)) {
+            return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+        }
+        if (i3ipc__json_match(&p.state, 0, NULL)) {
+            return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+        }
+
+        if (!context->staticalloc) {
+            /* Copy everything into a single block, which the user can free */
+            I3ipc_compact c;
+            memset(&c, 0, sizeof(c));
+            char* memory = i3ipc__reply_alloc(context, p.live_size + (zerocopy ? json_size + 1 : 0));
+            c.memory = memory + type.size;
+            c.intern = p.intern;
+            if (zerocopy) {
+                c.json = json;
+                c.json_copy = memory + p.live_size;
+                c.json_size = json_size;
+                memcpy(c.json_copy, json, json_size + 1);
+            }
+            memcpy(memory, base, type.size);
+            i3ipc__parse_compact_helper(type_id, 0, memory, -1, &c);
+            assert(c.memory <= memory + p.live_size);
+            base = memory;
+        }
+        
+        if (out_data) *out_data = base;
+        return 0;
+    }
+    
+    /* Allocate space for the base type */
     i3ipc__parse_alloc(&p, type.size, type.alignment, NULL);
 
     /* First pass, determine sizes of things */
@@ -2503,23 +6448,61 @@ int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** ou
 
     /* Process allocations, fixing alignment */
     size_t off = 0;
+    size_t max_alignment = 1;
     for (int i = 0; i < p.allocs_size; ++i) {
         size_t i_size = p.allocs[i].size;
         off = (off + p.allocs[i].alignment-1) & ~(p.allocs[i].alignment-1);
         p.allocs[i].size = off;
         off += i_size;
+        if (max_alignment < p.allocs[i].alignment) max_alignment = p.allocs[i].alignment;
     }
     size_t total_size = off;
+    if (sizeonly) {
+        *io_size = total_size;
+        return 0;
+    }
 
     /* Allocate memory */
-    if (context->staticalloc) {
+    char* json_copy = NULL;
+    if (into) {
+        if (total_size > *io_size) {
+            fprintf(i3ipc__err, "buffer too small, has %lu bytes, needs %lu\n",
+                (unsigned long)*io_size, (unsigned long)total_size);
+            return i3ipc__error_handle(I3IPC_ERROR_FAILED);
+        } else if ((size_t)into & (max_alignment-1)) {
+            fprintf(i3ipc__err, "buffer is not aligned to %lu bytes\n", (unsigned long)max_alignment);
+            return i3ipc__error_handle(I3IPC_ERROR_FAILED);
+        }
+        p.memory = into;
+        memset(p.memory, 0, total_size);
+    } else if (context->staticalloc) {
         i3ipc__context_reserve(context, I3IPC_CONTEXT_PARSE, total_size, (void**)&p.memory);
         memset(p.memory, 0, total_size);
+    } else if (zerocopy) {
+        /* The second pass reads the json from behind the result, so strings end up pointing there */
+        p.memory = i3ipc__reply_alloc(context, total_size + json_size + 1);
+        memset(p.memory, 0, total_size);
+        json_copy = p.memory + total_size;
+        memcpy(json_copy, json, json_size + 1);
     } else {
-        p.memory = (char*)calloc(total_size, 1);
+        p.memory = i3ipc__reply_alloc(context, total_size);
+        memset(p.memory, 0, total_size);
     }
     p.allocs_size = 0;
-    p.state.tokens_cur = 0;
+    if (stream) {
+        if (json_copy) {
+            i3ipc__json_stream_begin(&p.state, json_copy, json_size);
+        } else {
+            i3ipc__json_stream_rewind(&p.state);
+        }
+        p.state.nomodify_flag = nondestructive;
+    } else {
+        p.state.tape_cur = 0;
+        if (json_copy) {
+            p.state.tape_json = json_copy;
+            p.state.tape_window_size = 0;
+        }
+    }
     char* base = i3ipc__parse_alloc(&p, type.size, type.alignment, NULL);
 
     /* Second pass, actually parse */
@@ -2531,31 +6514,636 @@ int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** ou
     return 0;
 }
 
-void i3ipc__type_readderived(I3ipc_type* type, int field, char* base, bool* out_set, int* out_size, int* out_enum) {
-    bool field_set = true;
-    int field_size = -1;
-    int field_enum = -1;
-    for (int j = field + 1; j < type->fields_size; ++j) {
-        I3ipc_field j_field = type->fields[j];
-        if (!(j_field.flags & I3IPC_TYPE_GROUP_DERIVED)) break;
-                
-        if (j_field.flags & I3IPC_TYPE_ISFLAG) {
-            assert(j_field.type == I3IPC_TYPE_BOOL);
-            field_set = *(bool*)(base + j_field.offset);
-        } else if (j_field.flags & I3IPC_TYPE_ISSIZE) {
-            assert(j_field.type == I3IPC_TYPE_INT);
-            field_size = *(int*)(base + j_field.offset);
-        } else if (j_field.flags & I3IPC_TYPE_ISENUM) {
-            assert(j_field.type == I3IPC_TYPE_INT);
-            field_enum = *(int*)(base + j_field.offset);
+int i3ipc_parse_try(I3ipc_message* msg, int message_type, int type_id, char** out_data) {
+    return i3ipc__parse_try(msg, message_type, type_id, out_data, NULL, NULL, NULL);
+}
+
+int i3ipc_parse_size_try(I3ipc_message* msg, int message_type, int type_id, size_t* out_size) {
+    size_t size = 0;
+    {int code = i3ipc__parse_try(msg, message_type, type_id, NULL, NULL, NULL, &size);
+    if (code) return code;}
+    
+    if (out_size) *out_size = size;
+    return 0;
+}
+
+int i3ipc_parse_into_try(I3ipc_message* msg, int message_type, int type_id, char* buf, size_t size) {
+    assert(buf);
+    return i3ipc__parse_try(msg, message_type, type_id, NULL, NULL, buf, &size);
+}
+
+/* Decode the json value at pos into base, which has type type_id. If record is not NULL, the value
+ * is a node and its children are only recorded. If toplevel is set, nothing may follow the value.
+ * The json is not modified, so that i3ipc_raw_get can look at it later. */
+int i3ipc__lazy_decode(I3ipc_lazy_tree* tree, int pos, int type_id, char* base, I3ipc_lazy_record* record, bool toplevel) {
+    I3ipc_parse_state p;
+    memset(&p, 0, sizeof(p));
+    p.context = &i3ipc__global_context;
+    p.arena = &tree->arena;
+    p.lazy_tree = tree;
+    p.lazy_record = record;
+    p.copy_strings = true;
+    i3ipc__json_stream_begin(&p.state, tree->json + pos, tree->json_size - pos);
+    p.state.nomodify_flag = true;
+    if (record) record->pos = pos;
+    
+    if (i3ipc__parse_helper(&p, type_id, 0, base)) return 1;
+    if (toplevel && i3ipc__json_match(&p.state, 0, NULL)) return 2;
+    return 0;
+}
+
+/* Iterate over the elements of the json array at *io_pos, using the bracket index to jump over
+ * them. Initially, *io_pos is the position of the '['. Return the position of the next element,
+ * -1 if there is none, or -2 if the array is not an array of objects. */
+int i3ipc__lazy_next(I3ipc_lazy_tree* tree, int* io_pos) {
+    char* json = tree->json;
+    int json_size = tree->json_size;
+    int i = *io_pos;
+    
+    bool first = json[i] == '[';
+    i = first ? i+1 : i3ipc__lazy_close(tree, i) + 1;
+    i += i3ipc__global_skip_space(json + i, json_size - i);
+    if (i < json_size && json[i] == ']') {
+        return -1;
+    } else if (!first) {
+        if (i >= json_size || json[i] != ',') return -2;
+        ++i;
+        i += i3ipc__global_skip_space(json + i, json_size - i);
+    }
+    if (i >= json_size || json[i] != '{') return -2;
+    
+    *io_pos = i;
+    return i;
+}
+
+/* The nodes of a previous tree, by the hash of their json, see i3ipc_parse_lazy_update_try. The
+ * slots are a hash table using linear probing. */
+typedef struct I3ipc_lazy_update {
+    I3ipc_lazy_tree* prev;
+    I3ipc_lazy_record** slots;
+    uint32_t slots_mask;
+} I3ipc_lazy_update;
+
+/* Return the hash of the json of the node at pos, which is never 0 */
+uint64_t i3ipc__lazy_hash(I3ipc_lazy_tree* tree, int pos) {
+    int size = i3ipc__lazy_close(tree, pos) + 1 - pos;
+    uint64_t hash = i3ipc__hash_string(tree->json + pos, size);
+    return hash ? hash : 1;
+}
+
+/* Set up update to find the nodes of prev, which may be NULL */
+void i3ipc__lazy_update_begin(I3ipc_lazy_update* update, I3ipc_lazy_tree* prev) {
+    memset(update, 0, sizeof(*update));
+    update->prev = prev;
+    if (!prev || !prev->records_size) return;
+
+    uint32_t capacity = 64;
+    while (capacity < 2 * (uint32_t)prev->records_size) capacity *= 2;
+    update->slots = (I3ipc_lazy_record**)i3ipc__calloc(capacity, sizeof(I3ipc_lazy_record*));
+    update->slots_mask = capacity - 1;
+    
+    for (int i = 0; i < prev->records_capacity; ++i) {
+        I3ipc_lazy_record* record = &prev->records[i];
+        if (!record->node || record->pos == -1) continue;
+        if (!record->hash) record->hash = i3ipc__lazy_hash(prev, record->pos);
+        
+        uint32_t slot = (uint32_t)record->hash & update->slots_mask;
+        while (update->slots[slot]) slot = (slot + 1) & update->slots_mask;
+        update->slots[slot] = record;
+    }
+}
+
+/* Return the record of a node of the previous tree with the same json as the node at pos of tree,
+ * or NULL if there is none. */
+I3ipc_lazy_record* i3ipc__lazy_update_find(I3ipc_lazy_update* update, I3ipc_lazy_tree* tree, int pos, uint64_t hash) {
+    if (!update->slots) return NULL;
+    I3ipc_lazy_tree* prev = update->prev;
+    int size = i3ipc__lazy_close(tree, pos) + 1 - pos;
+    
+    for (uint32_t slot = (uint32_t)hash & update->slots_mask; update->slots[slot]; slot = (slot + 1) & update->slots_mask) {
+        I3ipc_lazy_record* record = update->slots[slot];
+        if (record->hash != hash) continue;
+        
+        /* Compare the json as well, so that a collision does not go unnoticed */
+        int record_size = i3ipc__lazy_close(prev, record->pos) + 1 - record->pos;
+        if (record_size == size && memcmp(prev->json + record->pos, tree->json + pos, size) == 0) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+int i3ipc__lazy_expand(I3ipc_lazy_tree* tree, I3ipc_node* node, I3ipc_lazy_update* update);
+
+/* Copy the node src of the previous tree of update into dst, including everything it references
+ * and its children. The json of src has moved by delta bytes. Nodes that were not expanded in the
+ * previous tree are expanded afterwards, so that the result is expanded completely. */
+int i3ipc__lazy_update_copy(I3ipc_lazy_tree* tree, I3ipc_lazy_update* update, I3ipc_node* dst, I3ipc_node* src, int delta) {
+    I3ipc_lazy_tree* prev = update->prev;
+    I3ipc_lazy_record* src_record = i3ipc__lazy_record(prev, src, false);
+    assert(src_record);
+    bool expanded = src_record->expanded;
+    I3ipc_lazy_record* record = i3ipc__lazy_record(tree, dst, true);
+    *record = *src_record;
+    record->node = dst;
+    record->pos += delta;
+    if (record->pos_nodes != -1) record->pos_nodes += delta;
+    if (record->pos_floating_nodes != -1) record->pos_floating_nodes += delta;
+    if (record->pos_window_properties != -1) record->pos_window_properties += delta;
+
+    /* Everything but the children can be copied without looking at it */
+    memcpy(dst, src, sizeof(I3ipc_node));
+    I3ipc_compact c;
+    memset(&c, 0, sizeof(c));
+    c.arena = &tree->arena;
+    I3ipc_type type = i3ipc__type_get(I3IPC_TYPE_NODE);
+    for (int i = 0; i < type.fields_size; ++i) {
+        I3ipc_field field = type.fields[i];
+        if (field.flags & I3IPC_TYPE_GROUP_DERIVED) continue;
+        if (field.offset == offsetof(I3ipc_node, nodes)) continue;
+        if (field.offset == offsetof(I3ipc_node, floating_nodes)) continue;
+
+        int i_size = -1;
+        i3ipc__type_readderived(&type, i, (char*)dst, NULL, &i_size, NULL);
+        i3ipc__parse_compact_helper(field.type, field.flags & ~I3IPC_TYPE_ISOPT, (char*)dst + field.offset, i_size, &c);
+    }
+
+    if (src->nodes) {
+        dst->nodes = (I3ipc_node*)i3ipc__arena_alloc(
+            &tree->arena, src->nodes_size * sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node)
+        );
+        for (int i = 0; i < src->nodes_size; ++i) {
+            if (i3ipc__lazy_update_copy(tree, update, &dst->nodes[i], &src->nodes[i], delta)) return 1;
+        }
+    }
+    if (src->floating_nodes) {
+        dst->floating_nodes = (I3ipc_node*)i3ipc__arena_alloc(
+            &tree->arena, src->floating_nodes_size * sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node)
+        );
+        for (int i = 0; i < src->floating_nodes_size; ++i) {
+            if (i3ipc__lazy_update_copy(tree, update, &dst->floating_nodes[i], &src->floating_nodes[i], delta)) return 1;
+        }
+    }
+    return expanded ? 0 : i3ipc__lazy_expand(tree, dst, update);
+}
+
+/* Decode the node at pos into node and expand it completely, unless the same json is part of the
+ * previous tree of update. Then the node from there is copied instead. */
+int i3ipc__lazy_update_node(I3ipc_lazy_tree* tree, I3ipc_lazy_update* update, I3ipc_node* node, int pos) {
+    uint64_t hash = 0;
+    if (update->prev) {
+        hash = i3ipc__lazy_hash(tree, pos);
+        I3ipc_lazy_record* found = i3ipc__lazy_update_find(update, tree, pos, hash);
+        if (found) {
+            return i3ipc__lazy_update_copy(tree, update, node, found->node, pos - found->pos);
+        }
+    }
+
+    I3ipc_lazy_record* record = i3ipc__lazy_record(tree, node, true);
+    record->hash = hash;
+    if (i3ipc__lazy_decode(tree, pos, I3IPC_TYPE_NODE, (char*)node, record, false)) return 1;
+    return i3ipc__lazy_expand(tree, node, update);
+}
+
+/* Decode the array of nodes at pos. If update is not NULL, the nodes are expanded as well, see
+ * i3ipc__lazy_update_node. */
+int i3ipc__lazy_expand_array(I3ipc_lazy_tree* tree, int pos, I3ipc_node** out_nodes, int* out_nodes_size, I3ipc_lazy_update* update) {
+    /* Count the elements first, so that the array can be allocated at once */
+    int count = 0;
+    int it, i_pos;
+    for (it = pos; (i_pos = i3ipc__lazy_next(tree, &it)) >= 0;) ++count;
+    if (i_pos == -2) {
+        fprintf(i3ipc__err, "expected array of nodes\n");
+        return 1;
+    }
+
+    I3ipc_node* nodes = (I3ipc_node*)i3ipc__arena_alloc(
+        &tree->arena, count * sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node)
+    );
+    int i = 0;
+    for (it = pos; (i_pos = i3ipc__lazy_next(tree, &it)) >= 0; ++i) {
+        if (update) {
+            if (i3ipc__lazy_update_node(tree, update, &nodes[i], i_pos)) return 2;
+            continue;
+        }
+        I3ipc_lazy_record* record = i3ipc__lazy_record(tree, &nodes[i], true);
+        if (i3ipc__lazy_decode(tree, i_pos, I3IPC_TYPE_NODE, (char*)&nodes[i], record, false)) return 2;
+    }
+
+    *out_nodes = nodes;
+    *out_nodes_size = count;
+    return 0;
+}
+
+/* Parse msg into a lazy tree. If update is not NULL, all nodes are expanded, see
+ * i3ipc__lazy_update_node. */
+int i3ipc__parse_lazy_try(I3ipc_message* msg, I3ipc_lazy_update* update, I3ipc_lazy_tree** out_tree) {
+    assert(msg);
+    if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
+    {int code = i3ipc_init_try(NULL);
+    if (code) return code;}
+    
+    if (msg->message_type != I3IPC_REPLY_TREE) {
+        fprintf(i3ipc__err, "Unexpected reply type, expected %s(%x), got %s(%x)\n",
+            i3ipc__message_type_str(I3IPC_REPLY_TREE, true), I3IPC_REPLY_TREE,
+            i3ipc__message_type_str(msg->message_type, true), msg->message_type);
+        return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    }
+
+    I3ipc_lazy_tree* tree = (I3ipc_lazy_tree*)i3ipc__calloc(1, sizeof(I3ipc_lazy_tree));
+    tree->json_size = msg->message_length;
+    tree->json = (char*)i3ipc__malloc(tree->json_size + 1);
+    memcpy(tree->json, msg + 1, tree->json_size);
+    tree->json[tree->json_size] = 0;
+
+    int pos = i3ipc__global_skip_space(tree->json, tree->json_size);
+    tree->root = (I3ipc_node*)i3ipc__arena_alloc(&tree->arena, sizeof(I3ipc_node), I3IPC_ALIGNOF(I3ipc_node));
+    int code = i3ipc__lazy_index(tree);
+    if (!code && update) {
+        if (pos < tree->json_size && tree->json[pos] == '{') {
+            code = i3ipc__lazy_update_node(tree, update, tree->root, pos);
+            int end = code ? 0 : i3ipc__lazy_close(tree, pos) + 1;
+            end += i3ipc__global_skip_space(tree->json + end, tree->json_size - end);
+            if (!code && end < tree->json_size) {
+                fprintf(i3ipc__err, "unexpected data after the tree\n");
+                code = 6;
+            }
         } else {
-            assert(false);
+            fprintf(i3ipc__err, "expected json object\n");
+            code = 5;
+        }
+    } else if (!code) {
+        I3ipc_lazy_record* record = i3ipc__lazy_record(tree, tree->root, true);
+        code = i3ipc__lazy_decode(tree, pos, I3IPC_TYPE_NODE, (char*)tree->root, record, true);
+    }
+    if (code) {
+        i3ipc_lazy_free(tree);
+        return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    }
+
+    if (out_tree) {
+        *out_tree = tree;
+    } else {
+        i3ipc_lazy_free(tree);
+    }
+    return 0;
+}
+
+int i3ipc_parse_lazy_try(I3ipc_message* msg, I3ipc_lazy_tree** out_tree) {
+    return i3ipc__parse_lazy_try(msg, NULL, out_tree);
+}
+
+int i3ipc_parse_lazy_update_try(I3ipc_message* msg, I3ipc_lazy_tree* prev, I3ipc_lazy_tree** out_tree) {
+    I3ipc_lazy_update update;
+    i3ipc__lazy_update_begin(&update, prev);
+    int code = i3ipc__parse_lazy_try(msg, &update, out_tree);
+    i3ipc__free(update.slots);
+    return code;
+}
+
+/* Decode the children of node, see i3ipc_lazy_expand. If update is not NULL, they are expanded as
+ * well. */
+int i3ipc__lazy_expand(I3ipc_lazy_tree* tree, I3ipc_node* node, I3ipc_lazy_update* update) {
+    I3ipc_lazy_record* record = i3ipc__lazy_record(tree, node, false);
+    assert(record); /* node must be part of tree */
+    if (record->expanded) return 0;
+    record->expanded = true;
+
+    /* Adding records for the children may move this one */
+    I3ipc_lazy_record rec = *record;
+    
+    if (rec.pos_window_properties != -1) {
+        I3ipc_type type = i3ipc__type_get(I3IPC_TYPE_NODE_WINDOW_PROPERTIES);
+        char* base = i3ipc__arena_alloc(&tree->arena, type.size, type.alignment);
+        if (i3ipc__lazy_decode(tree, rec.pos_window_properties, I3IPC_TYPE_NODE_WINDOW_PROPERTIES, base, NULL, false)) {
+            return 1;
+        }
+        node->window_properties = (I3ipc_node_window_properties*)base;
+    }
+    if (rec.pos_nodes != -1) {
+        if (i3ipc__lazy_expand_array(tree, rec.pos_nodes, &node->nodes, &node->nodes_size, update)) {
+            return 2;
+        }
+    }
+    if (rec.pos_floating_nodes != -1) {
+        if (i3ipc__lazy_expand_array(tree, rec.pos_floating_nodes, &node->floating_nodes, &node->floating_nodes_size, update)) {
+            return 3;
         }
     }
+    return 0;
+}
 
-    if (out_set) *out_set = field_set;
-    if (out_size) *out_size = field_size;
-    if (out_enum) *out_enum = field_enum;
+int i3ipc_lazy_expand_try(I3ipc_lazy_tree* tree, I3ipc_node* node) {
+    assert(tree && node);
+    if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
+    if (i3ipc__lazy_expand(tree, node, NULL)) return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    return 0;
+}
+
+I3ipc_node* i3ipc_lazy_root(I3ipc_lazy_tree* tree) {
+    assert(tree);
+    return tree->root;
+}
+
+I3ipc_node* i3ipc_lazy_expand(I3ipc_lazy_tree* tree, I3ipc_node* node) {
+    if (i3ipc_lazy_expand_try(tree, node)) return NULL;
+    return node;
+}
+
+void i3ipc_lazy_free(I3ipc_lazy_tree* tree) {
+    if (!tree) return;
+    i3ipc__arena_free(&tree->arena);
+    i3ipc__free(tree->json);
+    i3ipc__free(tree->bracket_open);
+    i3ipc__free(tree->bracket_close);
+    i3ipc__free(tree->records);
+    i3ipc__free(tree);
+}
+
+/* Scan the json token at pos of tree into out_tok, without modifying the json. Return the position
+ * after it, or -1 on error. */
+int i3ipc__raw_token(I3ipc_lazy_tree* tree, int pos, I3ipc_json_token* out_tok) {
+    I3ipc_json_state state;
+    memset(&state, 0, sizeof(state));
+    i3ipc__json_stream_begin(&state, tree->json + pos, tree->json_size - pos);
+    state.nomodify_flag = true;
+    if (i3ipc__json_scan_token(&state, out_tok) || out_tok->type == 0) return -1;
+    return (int)(state.cur - tree->json);
+}
+
+/* Return the position after the json value at pos, using the bracket index to jump over arrays and
+ * objects, or -1 on error. */
+int i3ipc__raw_skip(I3ipc_lazy_tree* tree, int pos) {
+    char c = tree->json[pos];
+    if (c == '[' || c == '{') return i3ipc__lazy_close(tree, pos) + 1;
+    I3ipc_json_token tok;
+    return i3ipc__raw_token(tree, pos, &tok);
+}
+
+/* Iterate over the json array or object at pos. Initially, *io_pos is pos, afterwards it is the
+ * position of the current element, or of the value of the current member. Its key is written to
+ * out_key, if that is not NULL. Return 1 if there is a next element, 0 if there is none, or -1 on
+ * error. */
+int i3ipc__raw_next(I3ipc_lazy_tree* tree, int pos, int* io_pos, I3ipc_json_token* out_key) {
+    char* json = tree->json;
+    int json_size = tree->json_size;
+    bool object = json[pos] == '{';
+    bool first = *io_pos == pos;
+    
+    int i = first ? pos + 1 : i3ipc__raw_skip(tree, *io_pos);
+    if (i < 0) return -1;
+    i += i3ipc__global_skip_space(json + i, json_size - i);
+    if (i < json_size && json[i] == (object ? '}' : ']')) {
+        return 0;
+    } else if (!first) {
+        if (i >= json_size || json[i] != ',') return -1;
+        ++i;
+        i += i3ipc__global_skip_space(json + i, json_size - i);
+    }
+    if (object) {
+        I3ipc_json_token key;
+        i = i3ipc__raw_token(tree, i, &key);
+        if (i < 0 || key.type != I3IPC_JSON_STRING) return -1;
+        if (out_key) *out_key = key;
+        i += i3ipc__global_skip_space(json + i, json_size - i);
+        if (i >= json_size || json[i] != ':') return -1;
+        ++i;
+        i += i3ipc__global_skip_space(json + i, json_size - i);
+    }
+    if (i >= json_size) return -1;
+    
+    *io_pos = i;
+    return 1;
+}
+
+/* Decode the json value at pos of tree into out */
+int i3ipc__raw_decode(I3ipc_lazy_tree* tree, int pos, I3ipc_raw* out) {
+    memset(out, 0, sizeof(*out));
+    out->tree = tree;
+    out->pos = pos;
+    
+    I3ipc_json_token tok;
+    if (i3ipc__raw_token(tree, pos, &tok) < 0) return 1;
+    switch (tok.type) {
+    case I3IPC_JSON_NULL: out->type = I3IPC_RAW_NULL; break;
+    case I3IPC_JSON_BOOL:
+        out->type = I3IPC_RAW_BOOL;
+        out->flag = tok.flag;
+        break;
+    case I3IPC_JSON_NUMBER:
+        out->type = I3IPC_RAW_NUMBER;
+        out->number = i3ipc__json_number_float(tok.num, tok.num_size);
+        break;
+    case I3IPC_JSON_STRING:
+        out->type = I3IPC_RAW_STRING;
+        out->str = i3ipc__arena_alloc(&tree->arena, tok.str_size + 1, 1);
+        out->str_size = tok.str_size;
+        i3ipc__json_str_copy(tok, out->str);
+        break;
+    case '[':
+    case '{': {
+        out->type = tok.type == '[' ? I3IPC_RAW_ARRAY : I3IPC_RAW_OBJECT;
+        int it = pos, code;
+        while ((code = i3ipc__raw_next(tree, pos, &it, NULL)) == 1) ++out->size;
+        if (code) return 2;
+    } break;
+    default:
+        return 3;
+    }
+    return 0;
+}
+
+int i3ipc_raw_member_try(I3ipc_raw raw, char const* name, I3ipc_raw* out_raw) {
+    assert(name);
+    if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
+    
+    /* Missing values propagate, so that accesses can be chained */
+    I3ipc_raw result;
+    memset(&result, 0, sizeof(result));
+    if (raw.type == I3IPC_RAW_MISSING) {
+        if (out_raw) *out_raw = result;
+        return 0;
+    } else if (raw.type != I3IPC_RAW_OBJECT) {
+        fprintf(i3ipc__err, "expected json object\n");
+        return i3ipc__error_handle(I3IPC_ERROR_FAILED);
+    }
+    
+    int name_size = strlen(name);
+    char buf[64];
+    I3ipc_json_token key;
+    int it = raw.pos, code, found = -1;
+    while ((code = i3ipc__raw_next(raw.tree, raw.pos, &it, &key)) == 1) {
+        if (key.str_size != name_size) continue;
+        
+        char const* key_str = i3ipc__json_str(key, buf, sizeof(buf));
+        char* key_copy = NULL;
+        if (!key_str) {
+            key_copy = (char*)i3ipc__malloc(key.str_raw_size);
+            key_str = i3ipc__json_str(key, key_copy, key.str_raw_size);
+        }
+        /* Like the parser, take the last one if a member appears more than once */
+        if (memcmp(key_str, name, name_size) == 0) found = it;
+        i3ipc__free(key_copy);
+    }
+    if (!code && found != -1) {
+        it = found;
+        code = i3ipc__raw_decode(raw.tree, found, &result) ? -1 : 0;
+    }
+    if (code) {
+        fprintf(i3ipc__err, "malformed json in lazy tree at offset %d\n", it);
+        return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    }
+
+    if (out_raw) *out_raw = result;
+    return 0;
+}
+
+int i3ipc_raw_index_try(I3ipc_raw raw, int index, I3ipc_raw* out_raw) {
+    if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
+    
+    /* Missing values propagate, so that accesses can be chained */
+    I3ipc_raw result;
+    memset(&result, 0, sizeof(result));
+    if (raw.type == I3IPC_RAW_MISSING) {
+        if (out_raw) *out_raw = result;
+        return 0;
+    } else if (raw.type != I3IPC_RAW_ARRAY) {
+        fprintf(i3ipc__err, "expected json array\n");
+        return i3ipc__error_handle(I3IPC_ERROR_FAILED);
+    }
+    
+    int it = raw.pos, code = 0;
+    for (int i = 0; index >= 0 && (code = i3ipc__raw_next(raw.tree, raw.pos, &it, NULL)) == 1; ++i) {
+        if (i == index) {
+            code = i3ipc__raw_decode(raw.tree, it, &result) ? -1 : 0;
+            break;
+        }
+    }
+    if (code) {
+        fprintf(i3ipc__err, "malformed json in lazy tree at offset %d\n", it);
+        return i3ipc__error_handle(I3IPC_ERROR_MALFORMED);
+    }
+
+    if (out_raw) *out_raw = result;
+    return 0;
+}
+
+I3ipc_raw i3ipc_raw_get(I3ipc_lazy_tree* tree, I3ipc_node* node, char const* name) {
+    assert(tree && node);
+    I3ipc_lazy_record* record = i3ipc__lazy_record(tree, node, false);
+    assert(record && record->pos != -1); /* node must be part of tree */
+
+    I3ipc_raw raw;
+    memset(&raw, 0, sizeof(raw));
+    raw.type = I3IPC_RAW_OBJECT;
+    raw.tree = tree;
+    raw.pos = record->pos;
+    return i3ipc_raw_member(raw, name);
+}
+
+I3ipc_raw i3ipc_raw_member(I3ipc_raw raw, char const* name) {
+    I3ipc_raw result;
+    memset(&result, 0, sizeof(result));
+    i3ipc_raw_member_try(raw, name, &result);
+    return result;
+}
+
+I3ipc_raw i3ipc_raw_index(I3ipc_raw raw, int index) {
+    I3ipc_raw result;
+    memset(&result, 0, sizeof(result));
+    i3ipc_raw_index_try(raw, index, &result);
+    return result;
+}
+
+/* Return the number of nodes in the subtree of node */
+int i3ipc__flat_count(I3ipc_node* node) {
+    int count = 1;
+    for (int i = 0; i < node->nodes_size; ++i) {
+        count += i3ipc__flat_count(&node->nodes[i]);
+    }
+    for (int i = 0; i < node->floating_nodes_size; ++i) {
+        count += i3ipc__flat_count(&node->floating_nodes[i]);
+    }
+    return count;
+}
+
+/* Write the subtree of node into tree, starting at index *io_index, which is advanced past it */
+void i3ipc__flat_fill(I3ipc_flat_tree* tree, I3ipc_node* node, int parent, bool floating, int* io_index) {
+    int i = (*io_index)++;
+    tree->node[i] = node;
+    tree->parent[i] = parent;
+    tree->first_child[i] = -1;
+    tree->next_sibling[i] = -1;
+    tree->floating[i] = floating;
+    tree->id[i] = node->id;
+    tree->type_enum[i] = node->type_enum;
+    tree->window[i] = node->window;
+    tree->focused[i] = node->focused;
+    tree->rect[i] = node->rect;
+
+    int prev = -1;
+    int children_size = node->nodes_size + node->floating_nodes_size;
+    for (int k = 0; k < children_size; ++k) {
+        bool k_floating = k >= node->nodes_size;
+        I3ipc_node* child = k_floating ? &node->floating_nodes[k - node->nodes_size] : &node->nodes[k];
+        if (prev == -1) {
+            tree->first_child[i] = *io_index;
+        } else {
+            tree->next_sibling[prev] = *io_index;
+        }
+        prev = *io_index;
+        i3ipc__flat_fill(tree, child, i, k_floating, io_index);
+    }
+    tree->subtree_end[i] = *io_index;
+}
+
+int i3ipc_parse_flat_try(I3ipc_message* msg, I3ipc_flat_tree** out_tree) {
+    /* The flat tree holds on to the nodes, so they must not be in the buffers of staticalloc */
+    I3ipc_context* context = &i3ipc__global_context;
+    bool staticalloc = context->staticalloc;
+    context->staticalloc = false;
+    I3ipc_reply_tree* reply = NULL;
+    int code = i3ipc__parse_try(msg, I3IPC_REPLY_TREE, I3IPC_TYPE_REPLY_TREE, (char**)&reply, NULL, NULL, NULL);
+    context->staticalloc = staticalloc;
+    if (code) return code;
+
+    /* All arrays are in the same block, ordered by alignment */
+    int size = i3ipc__flat_count(&reply->root);
+    size_t block_size = sizeof(I3ipc_flat_tree)
+        + size * (sizeof(I3ipc_node*) + sizeof(size_t) + sizeof(I3ipc_rect) + 6 * sizeof(int) + 2 * sizeof(bool));
+    I3ipc_flat_tree* tree = (I3ipc_flat_tree*)i3ipc__malloc(block_size);
+    char* cur = (char*)(tree + 1);
+    tree->size = size;
+    tree->node         = (I3ipc_node**)cur; cur += size * sizeof(I3ipc_node*);
+    tree->id           = (size_t*)    cur; cur += size * sizeof(size_t);
+    tree->rect         = (I3ipc_rect*)cur; cur += size * sizeof(I3ipc_rect);
+    tree->parent       = (int*)       cur; cur += size * sizeof(int);
+    tree->first_child  = (int*)       cur; cur += size * sizeof(int);
+    tree->next_sibling = (int*)       cur; cur += size * sizeof(int);
+    tree->subtree_end  = (int*)       cur; cur += size * sizeof(int);
+    tree->type_enum    = (int*)       cur; cur += size * sizeof(int);
+    tree->window       = (int*)       cur; cur += size * sizeof(int);
+    tree->floating     = (bool*)      cur; cur += size * sizeof(bool);
+    tree->focused      = (bool*)      cur; cur += size * sizeof(bool);
+    assert(cur == (char*)tree + block_size);
+    tree->reply = reply;
+
+    int index = 0;
+    i3ipc__flat_fill(tree, &reply->root, -1, false, &index);
+    assert(index == size);
+
+    if (out_tree) {
+        *out_tree = tree;
+    } else {
+        i3ipc_flat_free(tree);
+    }
+    return 0;
+}
+
+void i3ipc_flat_free(I3ipc_flat_tree* tree) {
+    if (!tree) return;
+    i3ipc_free(tree->reply);
+    i3ipc__free(tree);
 }
 
 bool i3ipc__field_is_set(int type_id, int type_flags, char* base) {
@@ -2707,11 +7295,19 @@ int i3ipc_message_and_parse_try(
     assert(out_data);
     if (i3ipc_error_code()) return I3IPC_ERROR_BADSTATE;
     
+    I3ipc_context* context = &i3ipc__global_context;
+    {int code = i3ipc_message_send_try(message, payload, payload_size);
+    if (code) return code;}
+    
+    /* Scan the reply while it is still arriving, so that lexing overlaps with i3 writing it. Replies
+     * to commands are tiny and usually do not need the lexer at all, see i3ipc__parse_success. */
+    I3ipc_json_state scan;
+    bool noscan = (context->parseflags & I3IPC_PARSE_STREAM) || i3ipc__success_json(type, NULL);
     I3ipc_message* msg;
-    {int code = i3ipc_message_try(message, payload, payload_size, &msg);
+    {int code = i3ipc__message_receive_try(message, &msg, noscan ? NULL : &scan);
     if (code) return code;}
 
-    {int code = i3ipc_parse_try(msg, message, type, out_data);
+    {int code = i3ipc__parse_try(msg, message, type, out_data, noscan ? NULL : &scan, NULL, NULL);
     if (code) return code;}
 
     return 0;
@@ -2815,6 +7411,36 @@ I3ipc_reply_tree* i3ipc_get_tree(void) {
     i3ipc_message_and_parse_try(I3IPC_GET_TREE, I3IPC_TYPE_REPLY_TREE, NULL, 0, (char**)&reply);
     return reply;
 }
+I3ipc_lazy_tree* i3ipc_get_tree_lazy(void) {
+    if (i3ipc_error_code()) return NULL;
+    
+    I3ipc_message* msg;
+    if (i3ipc_message_try(I3IPC_GET_TREE, NULL, 0, &msg)) return NULL;
+
+    I3ipc_lazy_tree* tree = NULL;
+    i3ipc_parse_lazy_try(msg, &tree);
+    return tree;
+}
+I3ipc_lazy_tree* i3ipc_get_tree_update(I3ipc_lazy_tree* prev) {
+    if (i3ipc_error_code()) return NULL;
+    
+    I3ipc_message* msg;
+    if (i3ipc_message_try(I3IPC_GET_TREE, NULL, 0, &msg)) return NULL;
+
+    I3ipc_lazy_tree* tree = NULL;
+    i3ipc_parse_lazy_update_try(msg, prev, &tree);
+    return tree;
+}
+I3ipc_flat_tree* i3ipc_get_tree_flat(void) {
+    if (i3ipc_error_code()) return NULL;
+    
+    I3ipc_message* msg;
+    if (i3ipc_message_try(I3IPC_GET_TREE, NULL, 0, &msg)) return NULL;
+
+    I3ipc_flat_tree* tree = NULL;
+    i3ipc_parse_flat_try(msg, &tree);
+    return tree;
+}
 I3ipc_reply_marks* i3ipc_get_marks(void) {
     I3ipc_reply_marks* reply = NULL;
     i3ipc_message_and_parse_try(I3IPC_GET_MARKS, I3IPC_TYPE_REPLY_MARKS, NULL, 0, (char**)&reply);
@@ -0,0 +1,209 @@
+#!/usr/bin/python3
+# This generates a parse function for each type in i3ipc__global_fields, and puts them into i3ipc.h
+# between the markers. Run it after changing the types. See I3IPC_GENERATED_PARSERS.
+
+import os
+import sys
+import re
+
+os.chdir(os.path.join(os.path.dirname(sys.argv[0]), '..'))
+
+MARK_BEGIN = '/* Begin of generated parsers, see misc/gen-parsers.py */\n'
+MARK_END = '/* End of generated parsers */\n'
+
+with open('i3ipc.h', 'r') as f: src = f.read()
+
+m = re.search(r'static I3ipc_field i3ipc__global_fields\[\] = \{\n(.*?)\n\};', src, re.S)
+if not m:
+    print('Error: i3ipc__global_fields not found')
+    sys.exit(1)
+
+primitives = {
+    'I3IPC_TYPE_BOOL': 'bool',
+    'I3IPC_TYPE_INT': 'int',
+    'I3IPC_TYPE_FLOAT': 'float',
+    'I3IPC_TYPE_SIZET': 'sizet',
+}
+
+# Expand the I3IPC__DO* macros into the same fields as the preprocessor, each as (name, type, flags)
+types = {}
+order = []
+cur = None
+for line in m.group(1).split('\n'):
+    line = line.strip()
+    if line.startswith('/*'): continue
+    m = re.match(r'I3IPC__(\w+)\s*\(([^)]*)\),?$', line)
+    if not m:
+        if line:
+            print('Error: cannot parse line "%s"' % (line,))
+            sys.exit(1)
+        continue
+    macro = m.group(1)
+    args = [i.strip() for i in m.group(2).split(',')]
+
+    if macro in ('TYPE_BEGIN', 'TYPE_BEGIN2'):
+        cur = {'id': args[0], 'ctype': args[1], 'inline': macro == 'TYPE_BEGIN2', 'fields': []}
+        types[args[0]] = cur
+        order.append(cur)
+        continue
+
+    T, sub, name = args[:3]
+    fields = cur['fields']
+    if macro == 'DOFIELD':
+        fields.append((name, sub, set()))
+    elif macro == 'DOPTR':
+        fields.append((name, sub, {'ISPTR'}))
+    elif macro == 'DOMAYBE':
+        fields.append((name, sub, {'ISOPT'}))
+        fields.append((name + '_set', 'I3IPC_TYPE_BOOL', {'ISFLAG'}))
+    elif macro in ('DOARRAY', 'DOARRAY2', 'DOARRAY3', 'DOENUM', 'DOENUM2'):
+        flags = {'ISARRAY'}
+        if macro == 'DOARRAY3' or (len(args) > 3 and 'ISOPT' in args[3]): flags.add('ISOPT')
+        fields.append((name, sub, flags))
+        fields.append((name + '_size', 'I3IPC_TYPE_INT', {'ISSIZE'}))
+        if macro.startswith('DOENUM'):
+            fields.append((name + '_enum', 'I3IPC_TYPE_INT', {'ISENUM'}))
+    else:
+        print('Error: unknown macro %s' % (macro,))
+        sys.exit(1)
+
+def gen_name(t):
+    return 'i3ipc__gen_' + t['ctype'][len('I3ipc_'):]
+
+def is_struct(t):
+    return t['id'] not in primitives and t['id'] not in ('I3IPC_TYPE_CHAR', 'I3IPC_TYPE_STRING') and t['fields']
+
+def elem_parser(sub):
+    if sub in primitives: return 'i3ipc__gen_%s_el' % (primitives[sub],)
+    if sub == 'I3IPC_TYPE_STRING': return 'i3ipc__gen_string_el'
+    return gen_name(types[sub])
+
+def elem_ctype(sub):
+    if sub == 'I3IPC_TYPE_SIZET': return 'size_t'
+    return types[sub]['ctype']
+
+# Return the lines parsing the field at index i of t, with derived fields following it
+def gen_field(t, i, indent):
+    name, sub, flags = t['fields'][i]
+    derived = []
+    for dname, _, dflags in t['fields'][i+1:]:
+        if not dflags & {'ISSIZE', 'ISFLAG', 'ISENUM'}: break
+        derived.append((dname, dflags))
+    out = []
+    def w(s): out.append(indent + s)
+
+    if sub == 'I3IPC_TYPE_CHAR' and 'ISARRAY' in flags:
+        w('char* str;')
+        w('int str_size;')
+        w('if (i3ipc__gen_string(p, %s, &str, &str_size)) return 3;' % ('true' if 'ISOPT' in flags else 'false',))
+        w('if (obj) {')
+        w('    obj->%s = str;' % (name,))
+        for j, (dname, dflags) in enumerate(derived):
+            if 'ISSIZE' in dflags:
+                w('    obj->%s = str_size;' % (dname,))
+            elif 'ISENUM' in dflags:
+                w('    I3ipc_enum_table* table = i3ipc__global_types[%s].fields[%d].enum_table;' % (t['id'], i+1+j))
+                w('    if (table) obj->%s = i3ipc__enum_lookup(table, str, str_size);' % (dname,))
+        w('}')
+    elif 'ISARRAY' in flags:
+        ctype = elem_ctype(sub)
+        w('char* arr;')
+        w('int arr_size = 0;')
+        maybe = 'ISOPT' in flags
+        if maybe:
+            w('if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {')
+            w('    arr = NULL;')
+            w('    if (i3ipc__gen_array(p, sizeof(%s), I3IPC_ALIGNOF(%s), &%s, obj ? &arr : NULL, &arr_size)) return 3;'
+                % (ctype, ctype, elem_parser(sub)))
+            w('    if (obj) obj->%s = (%s*)arr;' % (name, ctype))
+            w('}')
+        else:
+            w('if (i3ipc__gen_array(p, sizeof(%s), I3IPC_ALIGNOF(%s), &%s, obj ? &arr : NULL, &arr_size)) return 3;'
+                % (ctype, ctype, elem_parser(sub)))
+            w('if (obj) obj->%s = (%s*)arr;' % (name, ctype))
+        for dname, dflags in derived:
+            assert 'ISSIZE' in dflags
+            w('if (obj) obj->%s = arr_size;' % (dname,))
+    elif 'ISPTR' in flags:
+        ctype = types[sub]['ctype']
+        w('if (!i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL)) {')
+        w('    char* ptr = i3ipc__parse_alloc(p, sizeof(%s), I3IPC_ALIGNOF(%s), NULL);' % (ctype, ctype))
+        w('    if (obj) obj->%s = (%s*)ptr;' % (name, ctype))
+        w('    if (%s(p, ptr)) return 3;' % (gen_name(types[sub]),))
+        w('}')
+    elif sub in primitives:
+        call = 'i3ipc__gen_%s(p, obj ? &obj->%s : NULL)' % (primitives[sub], name)
+        if 'ISOPT' in flags:
+            w('bool set = !i3ipc__json_trymatch(&p->state, I3IPC_JSON_NULL, NULL);')
+            w('if (set && %s) return 3;' % (call,))
+            for dname, dflags in derived:
+                assert 'ISFLAG' in dflags
+                w('if (obj) obj->%s = set;' % (dname,))
+        else:
+            assert not derived
+            w('if (%s) return 3;' % (call,))
+    else:
+        assert not flags and not derived
+        w('if (%s(p, obj ? (char*)&obj->%s : NULL)) return 3;' % (gen_name(types[sub]), name))
+    return out
+
+out = []
+out.append(MARK_BEGIN)
+out.append('#if I3IPC_GENERATED_PARSERS\n\n')
+
+structs = [t for t in order if is_struct(t)]
+for t in structs:
+    out.append('int %s(I3ipc_parse_state* p, char* base);\n' % (gen_name(t),))
+out.append('\n')
+
+for t in structs:
+    out.append('int %s(I3ipc_parse_state* p, char* base) {\n' % (gen_name(t),))
+    out.append('    %s* obj = (%s*)base;\n' % (t['ctype'], t['ctype']))
+    if t['inline']:
+        out.append('    {\n')
+        out += [i + '\n' for i in gen_field(t, 0, '        ')]
+        out.append('    }\n')
+        out.append('    return 0;\n')
+        out.append('}\n\n')
+        continue
+
+    if t['id'] == 'I3IPC_TYPE_NODE':
+        out.append('    if (i3ipc__parse_parallel_ready(p)) return i3ipc__parse_parallel_take(p, base);\n')
+    out.append('    uint64_t skip = p->context->projection_skip[%s];\n' % (t['id'],))
+    out.append('    for (int field = -1; i3ipc__parse_loopfields(&p->state, &i3ipc__global_types[%s], &field);) {\n' % (t['id'],))
+    out.append('        if (skip >> field & 1) {\n')
+    out.append('            if (i3ipc__json_skip(&p->state)) return 3;\n')
+    out.append('            continue;\n')
+    out.append('        }\n')
+    out.append('        switch (field) {\n')
+    for i, (name, sub, flags) in enumerate(t['fields']):
+        if flags & {'ISSIZE', 'ISFLAG', 'ISENUM'}: continue
+        out.append('        case %d: { /* %s */\n' % (i, name))
+        out += [j + '\n' for j in gen_field(t, i, '            ')]
+        out.append('        } break;\n')
+    out.append('        default: assert(false);\n')
+    out.append('        }\n')
+    out.append('    }\n')
+    out.append('    if (p->state.err_flag) return 9;\n')
+    out.append('    return 0;\n')
+    out.append('}\n\n')
+
+out.append('/* Return the generated parser for type_id, or NULL if there is none */\n')
+out.append('I3ipc_gen_parse i3ipc__gen_parser(int type_id) {\n')
+out.append('    switch (type_id) {\n')
+for t in structs:
+    out.append('    case %s: return &%s;\n' % (t['id'], gen_name(t)))
+out.append('    default: return NULL;\n')
+out.append('    }\n')
+out.append('}\n\n')
+out.append('#endif /* I3IPC_GENERATED_PARSERS */\n')
+out.append(MARK_END)
+
+begin = src.find(MARK_BEGIN)
+end = src.find(MARK_END)
+if begin == -1 or end == -1:
+    print('Error: markers not found in i3ipc.h')
+    sys.exit(1)
+
+with open('i3ipc.h', 'w') as f:
+    f.write(src[:begin] + ''.join(out) + src[end + len(MARK_END):])
@@ -8,8 +8,8 @@ CLANG=clang
 CLANGXX=clang++
 AFL_GCC=afl-gcc
 AFL_FUZZ=afl-fuzz
-CFLAGS="-Werror -Wall -Wextra -Wno-sign-compare -Wno-unused-parameter -fmax-errors=2 -ggdb"
-CFLAGS_PEDANTIC="-Werror -Wall -Wextra -Wpedantic -ggdb -O3"
+CFLAGS="-Werror -Wall -Wextra -Wno-sign-compare -Wno-unused-parameter -fmax-errors=2 -ggdb -pthread"
+CFLAGS_PEDANTIC="-Werror -Wall -Wextra -Wpedantic -ggdb -O3 -pthread"
 CFLAGS_SANITIZE="$CFLAGS_PEDANTIC -fsanitize=address -fsanitize=undefined"
 PRE="AFL_PRELOAD=/usr/local/lib/afl/libdislocator.so"
 
@@ -26,6 +26,7 @@ if [ "$#" -lt 1 ]; then
     echo "  pedantic        Compile a bunch of executables with lots of warnings enabled. (gcc, clang)"
     echo "  fuzz            Binary with instrumentation for fuzzing and some hardening (afl-gcc)"
     echo "  fuzz_run        Set up the environment for fuzzing. May only work on my machine."
+    echo "  bench           Optimised executable for running benchmarks (gcc)"
     echo
     echo "All executables are built into ../build"
     exit 1
@@ -65,9 +66,11 @@ elif [ "$1" = "fuzz_run" ]; then
     sudo -- sh -c 'echo core >/proc/sys/kernel/core_pattern'
     sudo -- sh -c 'cd /sys/devices/system/cpu; echo performance | tee cpu*/cpufreq/scaling_governor' >/dev/null
     mkdir -p ../build/fuzz/input ../build/fuzz/output
-    cp tests/handwritten/execute ../build/fuzz/input
+    cp tests/handwritten/execute tests/handwritten/deep00 tests/handwritten/deep01 ../build/fuzz/input
     echo "# Fuzzing environment set up, run the following command (or something similar) to start fuzzing"
     echo "$PRE" "$AFL_FUZZ" -i ../build/fuzz/input -o ../build/fuzz/output -- ../build/i3ipc_test_fuzz fuzz
+elif [ "$1" = "bench" ]; then
+    "$GCC" $CFLAGS -O2 i3ipc_test.c -o ../build/i3ipc_test_bench
 else
     echo "Error: first argument not recognised"
     exit 1
@@ -5,14 +5,20 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <ftw.h>
+#include <malloc.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
 #define I3IPC_FUZZ
 #endif
 
+#ifndef I3IPC_THREADS
+#define I3IPC_THREADS 1
+#endif
+
 #define I3IPC_IMPLEMENTATION
 #include "../i3ipc.h"
 
@@ -226,12 +232,768 @@ enum I3ipctest_codes {
     I3IPCTEST_WRONG_HASH,
     I3IPCTEST_WRONG_FORMAT,
     I3IPCTEST_BAD_MESSAGE,
-    I3IPCTEST_FIXPOINT_NOMATCH_JSON
+    I3IPCTEST_FIXPOINT_NOMATCH_JSON,
+    I3IPCTEST_VARIANT_NOMATCH
 };
 
+/* Parse flags, vector instruction levels (-1 is the default), staticalloc settings and whether to
+ * use the interpreter instead of the generated parsers, which are checked against the default
+ * parse. They must give the same results. */
+struct { int flags; int simd; bool staticalloc; bool interpret; } const i3ipctest_parse_variants[] = {
+    {I3IPC_PARSE_STREAM, -1, false, false},
+    {0, I3IPC__SIMD_SCALAR, false, false},
+    {0, I3IPC__SIMD_SSE2, false, false},
+    {I3IPC_PARSE_STREAM, I3IPC__SIMD_SCALAR, false, false},
+    {I3IPC_PARSE_SINGLEPASS, -1, false, false},
+    {I3IPC_PARSE_SINGLEPASS, -1, true, false},
+    {I3IPC_PARSE_SINGLEPASS | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_PARALLEL, -1, false, false},
+    {I3IPC_PARSE_PARALLEL, -1, true, false},
+    {I3IPC_PARSE_INTERN, -1, false, false},
+    {I3IPC_PARSE_INTERN | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_INTERN | I3IPC_PARSE_SINGLEPASS, -1, false, false},
+    {I3IPC_PARSE_INTERN | I3IPC_PARSE_SINGLEPASS | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_INTERN | I3IPC_PARSE_PARALLEL, -1, false, false},
+    {I3IPC_PARSE_INTERN_POOL, -1, false, false},
+    {I3IPC_PARSE_INTERN_POOL | I3IPC_PARSE_SINGLEPASS, -1, false, false},
+    {I3IPC_PARSE_ZEROCOPY, -1, false, false},
+    {I3IPC_PARSE_ZEROCOPY | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_ZEROCOPY | I3IPC_PARSE_SINGLEPASS, -1, false, false},
+    {I3IPC_PARSE_ZEROCOPY | I3IPC_PARSE_PARALLEL, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE, -1, true, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_STREAM, I3IPC__SIMD_SCALAR, true, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_SINGLEPASS, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_SINGLEPASS, -1, true, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_SINGLEPASS | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_PARALLEL, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_INTERN, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_INTERN | I3IPC_PARSE_STREAM, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE | I3IPC_PARSE_ZEROCOPY, -1, false, false},
+    {I3IPC_PARSE_NONDESTRUCTIVE, -1, false, true},
+    {0, -1, false, true},
+    {I3IPC_PARSE_STREAM, -1, false, true},
+    {I3IPC_PARSE_SINGLEPASS, -1, false, true},
+    {I3IPC_PARSE_PARALLEL, -1, false, true}
+};
+
+int i3ipctest_lazy_expand_all(I3ipc_lazy_tree* tree, I3ipc_node* node) {
+    {int code = i3ipc_lazy_expand_try(tree, node);
+    if (code) return code;}
+    
+    for (int i = 0; i < node->nodes_size; ++i) {
+        int code = i3ipctest_lazy_expand_all(tree, &node->nodes[i]);
+        if (code) return code;
+    }
+    for (int i = 0; i < node->floating_nodes_size; ++i) {
+        int code = i3ipctest_lazy_expand_all(tree, &node->floating_nodes[i]);
+        if (code) return code;
+    }
+    return 0;
+}
+
+/* Check that the raw values of the expanded tree agree with the decoded nodes */
+bool i3ipctest_lazy_check_raw(I3ipc_lazy_tree* tree, I3ipc_node* node) {
+    I3ipc_raw name = i3ipc_raw_get(tree, node, "name");
+    if (name.type == I3IPC_RAW_STRING) {
+        if (!node->name || name.str_size != node->name_size) return false;
+        if (memcmp(name.str, node->name, name.str_size)) return false;
+    } else if (node->name) {
+        return false;
+    }
+    
+    I3ipc_raw nodes = i3ipc_raw_get(tree, node, "nodes");
+    int nodes_size = nodes.type == I3IPC_RAW_ARRAY ? nodes.size : 0;
+    if (nodes_size != node->nodes_size) return false;
+    for (int i = 0; i < nodes_size; ++i) {
+        /* Elements are the same objects as the children */
+        I3ipc_raw el = i3ipc_raw_index(nodes, i);
+        if (el.type != I3IPC_RAW_OBJECT || el.pos != i3ipc__lazy_record(tree, &node->nodes[i], false)->pos) {
+            return false;
+        }
+    }
+    if (i3ipc_raw_index(nodes, nodes_size).type != I3IPC_RAW_MISSING) return false;
+    
+    if (i3ipc_raw_get(tree, node, "no such member").type != I3IPC_RAW_MISSING) return false;
+    if (i3ipc_raw_member(i3ipc_raw_get(tree, node, "no such member"), "x").type != I3IPC_RAW_MISSING) return false;
+    if (i3ipc_error_code()) return false;
+
+    for (int i = 0; i < node->nodes_size; ++i) {
+        if (!i3ipctest_lazy_check_raw(tree, &node->nodes[i])) return false;
+    }
+    for (int i = 0; i < node->floating_nodes_size; ++i) {
+        if (!i3ipctest_lazy_check_raw(tree, &node->floating_nodes[i])) return false;
+    }
+    return true;
+}
+
+/* Return a copy of the GET_TREE reply msg with a space inserted after the first '[' and the first
+ * letter of the last name changed. A tree parsed from it shares most of its nodes with msg, but
+ * their json is at a different position. */
+I3ipc_message* i3ipctest_tree_modify(I3ipc_message* msg) {
+    char* json = (char*)(msg + 1);
+    int json_size = msg->message_length;
+    char const* pattern = "\"name\":\"";
+    int pattern_size = strlen(pattern);
+    
+    int bracket = -1, name = -1;
+    for (int i = 0; i < json_size; ++i) {
+        if (bracket == -1 && json[i] == '[') bracket = i;
+        if (i + pattern_size < json_size && memcmp(json + i, pattern, pattern_size) == 0) {
+            name = i + pattern_size;
+        }
+    }
+
+    I3ipc_message* result = (I3ipc_message*)calloc(sizeof(*msg) + json_size + 2, 1);
+    memcpy(result, msg, sizeof(*msg));
+    result->message_type = I3IPC_REPLY_TREE;
+    char* result_json = (char*)(result + 1);
+    int size = 0;
+    for (int i = 0; i < json_size; ++i) {
+        char c = json[i];
+        if (i == name && 'a' <= c && c <= 'z') c = c == 'x' ? 'y' : 'x';
+        result_json[size++] = c;
+        if (i == bracket) result_json[size++] = ' ';
+    }
+    result->message_length = size;
+    return result;
+}
+
+/* Parse msg after feeding its payload to the scanner in pieces of chunk bytes, as if it arrived
+ * from the socket that way */
+int i3ipctest_parse_chunked(I3ipc_message* msg, int type, int chunk, char** out_data) {
+    I3ipc_context* context = &i3ipc__global_context;
+    I3ipc_json_state scan;
+    char* json = (char*)(msg + 1);
+    if (i3ipc__json_scan_begin(context, &scan, json, msg->message_length)) {
+        int code = 0;
+        for (int size = chunk; !code && size < msg->message_length; size += chunk) {
+            code = i3ipc__json_scan_feed(context, &scan, size, false);
+        }
+        if (!code) code = i3ipc__json_scan_feed(context, &scan, msg->message_length, true);
+        if (code) i3ipc__error_clearbuf();
+    }
+    return i3ipc__parse_try(msg, type + 1000, type, out_data, &scan, NULL, NULL);
+}
+
+/* Check that the subtree of node is at index i of the flat tree, return the index after it or -1 */
+int i3ipctest_flat_check(I3ipc_flat_tree* tree, I3ipc_node* node, int i, int parent, bool floating) {
+    if (i >= tree->size || tree->node[i] != node || tree->parent[i] != parent) return -1;
+    if (tree->floating[i] != floating || tree->id[i] != node->id) return -1;
+    if (tree->type_enum[i] != node->type_enum || tree->window[i] != node->window) return -1;
+    if (tree->focused[i] != node->focused || memcmp(&tree->rect[i], &node->rect, sizeof(I3ipc_rect))) return -1;
+
+    int next = i + 1;
+    int prev = -1;
+    for (int k = 0; k < node->nodes_size + node->floating_nodes_size; ++k) {
+        bool k_floating = k >= node->nodes_size;
+        I3ipc_node* child = k_floating ? &node->floating_nodes[k - node->nodes_size] : &node->nodes[k];
+        if ((prev == -1 ? tree->first_child[i] : tree->next_sibling[prev]) != next) return -1;
+        prev = next;
+        next = i3ipctest_flat_check(tree, child, next, i, k_floating);
+        if (next == -1) return -1;
+    }
+    if (prev == -1 ? tree->first_child[i] != -1 : tree->next_sibling[prev] != -1) return -1;
+    if (tree->subtree_end[i] != next) return -1;
+    return next;
+}
+
+/* Allocator that tags its memory, so that mixing it up with malloc is noticed, and counts how many
+ * allocations are live. user points to the counter. */
+#define I3IPCTEST_ALLOC_MAGIC UINT64_C(0x616c6c6f63746573)
+#define I3IPCTEST_ALLOC_HEADER 16
+
+void* i3ipctest_alloc(void* user, size_t size) {
+    char* ptr = (char*)malloc(I3IPCTEST_ALLOC_HEADER + size);
+    if (!ptr) return NULL;
+    uint64_t magic = I3IPCTEST_ALLOC_MAGIC;
+    memcpy(ptr, &magic, sizeof(magic));
+    ++*(int*)user;
+    return ptr + I3IPCTEST_ALLOC_HEADER;
+}
+char* i3ipctest_alloc_check(void* ptr) {
+    char* base = (char*)ptr - I3IPCTEST_ALLOC_HEADER;
+    uint64_t magic;
+    memcpy(&magic, base, sizeof(magic));
+    if (magic != I3IPCTEST_ALLOC_MAGIC) {
+        fprintf(stderr, "Error: memory was not allocated by the allocator\n");
+        abort();
+    }
+    return base;
+}
+void* i3ipctest_realloc(void* user, void* ptr, size_t size) {
+    (void)user;
+    char* base = (char*)realloc(i3ipctest_alloc_check(ptr), I3IPCTEST_ALLOC_HEADER + size);
+    return base ? base + I3IPCTEST_ALLOC_HEADER : NULL;
+}
+void i3ipctest_free(void* user, void* ptr) {
+    char* base = i3ipctest_alloc_check(ptr);
+    memset(base, 0, sizeof(uint64_t));
+    free(base);
+    --*(int*)user;
+}
+
+/* Return a copy of msg, which has to be freed */
+I3ipc_message* i3ipctest_msg_copy(I3ipc_message const* msg) {
+    size_t size = sizeof(*msg) + msg->message_length + 1;
+    I3ipc_message* result = (I3ipc_message*)calloc(size, 1);
+    memcpy(result, msg, size);
+    return result;
+}
+
+/* Clear the error of a call that was allowed to fail, so that the next one is attempted. If
+ * reconnect is set, e.g. because i3 could not be reached, the next call initialises again. */
+void i3ipctest_reset_error(bool reconnect) {
+    i3ipc__error_clearbuf();
+    i3ipc__global_context.state = reconnect ? I3IPC_STATE_UNINITIALIZED : I3IPC_STATE_READY;
+}
+
+/* The settings that the variants change, see i3ipctest_settings_save */
+typedef struct I3ipctest_settings {
+    int parseflags;
+    bool staticalloc;
+    int simd;
+    int parse_threads;
+    int generations;
+    bool poison;
+    bool reply_pool;
+} I3ipctest_settings;
+
+/* Return the current settings, to be put back by i3ipctest_settings_restore after a variant */
+I3ipctest_settings i3ipctest_settings_save(void) {
+    I3ipc_context* context = &i3ipc__global_context;
+    I3ipctest_settings s;
+    s.parseflags = context->parseflags;
+    s.staticalloc = context->staticalloc;
+    s.simd = i3ipc__global_simd_level;
+    s.parse_threads = context->parse_threads;
+    s.generations = context->staticalloc_generations;
+    s.poison = context->staticalloc_poison;
+    s.reply_pool = context->reply_pool_flag;
+    return s;
+}
+
+/* Put back the settings s, and turn the debug flags off. Only settings that changed are set, so
+ * that e.g. the generations of a staticalloc result are not freed. */
+void i3ipctest_settings_restore(I3ipctest_settings const* s) {
+    I3ipc_context* context = &i3ipc__global_context;
+    i3ipc_set_parseflags(s->parseflags);
+    i3ipc_set_staticalloc(s->staticalloc);
+    if (i3ipc__global_simd_level != s->simd) i3ipc__simd_select(s->simd);
+    i3ipc_set_parse_threads(s->parse_threads);
+    if (context->staticalloc_generations != s->generations) i3ipc_set_staticalloc_generations(s->generations);
+    i3ipc_set_staticalloc_poison(s->poison);
+    if (context->reply_pool_flag != s->reply_pool) i3ipc_set_reply_pool(s->reply_pool);
+    context->debug_parallel_always = false;
+    context->debug_interpret = false;
+}
+
+int i3ipctest_parse_variants_msg(I3ipc_message* msg_orig, int code_orig, uint64_t hash_orig, bool silent) {
+    int type = msg_orig->message_type - 1000;
+    size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+    
+    int variants_size = sizeof(i3ipctest_parse_variants) / sizeof(i3ipctest_parse_variants[0]);
+    for (int i = 0; i < variants_size; ++i) {
+        int flags = i3ipctest_parse_variants[i].flags;
+        int simd  = i3ipctest_parse_variants[i].simd;
+        bool staticalloc = i3ipctest_parse_variants[i].staticalloc;
+        bool interpret = i3ipctest_parse_variants[i].interpret;
+        
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+        char* data = NULL;
+        I3ipctest_settings settings = i3ipctest_settings_save();
+        i3ipc_set_staticalloc(staticalloc);
+        i3ipc_set_parseflags(flags);
+        i3ipc__simd_select(simd);
+        /* Split even small trees, on more threads than there may be processors */
+        i3ipc_set_parse_threads(3);
+        i3ipc__global_context.debug_parallel_always = true;
+        i3ipc__global_context.debug_interpret = interpret;
+        int code = i3ipc_parse_try(msg, type + 1000, type, &data);
+        i3ipctest_settings_restore(&settings);
+        if (code) i3ipctest_reset_error(false);
+        
+        /* The message must stay as it was, including its length */
+        bool unchanged = !(flags & I3IPC_PARSE_NONDESTRUCTIVE) || memcmp(msg, msg_orig, msg_size) == 0;
+        
+        /* Without staticalloc, the result must not reference the message */
+        if (!staticalloc) {
+            free(msg);
+            msg = NULL;
+        }
+        
+        bool matches = (code != 0) == (code_orig != 0) && unchanged;
+        if (matches && !code) {
+            matches = i3ipctest_hash_generic(type, data) == hash_orig;
+        }
+        if (!staticalloc) free(data);
+        free(msg);
+        if (flags & I3IPC_PARSE_INTERN_POOL) i3ipc_intern_pool_free();
+        
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse with flags %x, simd %d, staticalloc %d, interpret %d does "
+                    "not match the default (code %d, %d)\n", flags, simd, (int)staticalloc, (int)interpret,
+                    code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    int chunks[] = {1, 7, 4096};
+    for (int i = 0; i < (int)(sizeof(chunks) / sizeof(chunks[0])); ++i) {
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+        char* data = NULL;
+        int code = i3ipctest_parse_chunked(msg, type, chunks[i], &data);
+        if (code) i3ipctest_reset_error(false);
+        
+        bool matches = (code != 0) == (code_orig != 0);
+        if (matches && !code) {
+            matches = i3ipctest_hash_generic(type, data) == hash_orig;
+        }
+        free(data);
+        free(msg);
+        
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse fed in chunks of %d bytes does not match the default "
+                    "(code %d, %d)\n", chunks[i], code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    for (int i = 0; i < variants_size; ++i) {
+        /* Parse into a buffer of exactly the right size, after checking that one byte less fails.
+         * Whatever the flags, both calls have to agree on the size. */
+        int flags = i3ipctest_parse_variants[i].flags;
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+        I3ipctest_settings settings = i3ipctest_settings_save();
+        i3ipc_set_parseflags(flags);
+        i3ipc_set_staticalloc(i3ipctest_parse_variants[i].staticalloc);
+        size_t size = 0;
+        char* data = NULL;
+        int code = i3ipc_parse_size_try(msg, type + 1000, type, &size);
+        bool unchanged = memcmp(msg, msg_orig, msg_size) == 0;
+        if (!code && size > 0) {
+            data = (char*)malloc(size);
+            bool nopanic = i3ipc_set_nopanic(true);
+            if (!i3ipc_parse_into_try(msg, type + 1000, type, data, size - 1)) unchanged = false;
+            i3ipctest_reset_error(false);
+            i3ipc_set_nopanic(nopanic);
+            memcpy(msg, msg_orig, msg_size);
+        }
+        if (!code) code = i3ipc_parse_into_try(msg, type + 1000, type, data, size);
+        i3ipctest_settings_restore(&settings);
+        if (code) i3ipctest_reset_error(false);
+        
+        /* The result must reference neither the message nor the string pool */
+        free(msg);
+        if (flags & I3IPC_PARSE_INTERN_POOL) i3ipc_intern_pool_free();
+        bool matches = (code != 0) == (code_orig != 0) && unchanged;
+        if (matches && !code) {
+            matches = i3ipctest_hash_generic(type, data) == hash_orig;
+        }
+        free(data);
+        
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse into a buffer with flags %x does not match the default "
+                    "(code %d, %d)\n", flags, code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    {
+        /* Parse with a custom allocator. Everything must be freed afterwards, either by the caller
+         * or when the allocator is replaced. */
+        int live = 0;
+        I3ipc_allocator allocator;
+        allocator.alloc = &i3ipctest_alloc;
+        allocator.realloc = &i3ipctest_realloc;
+        allocator.free = &i3ipctest_free;
+        allocator.user = &live;
+        i3ipc_set_allocator(&allocator);
+        
+        int flags[] = {0, I3IPC_PARSE_ZEROCOPY, I3IPC_PARSE_STREAM | I3IPC_PARSE_INTERN,
+            I3IPC_PARSE_PARALLEL | I3IPC_PARSE_INTERN_POOL};
+        bool matches = true;
+        int code = 0;
+        for (int i = 0; i < (int)(sizeof(flags) / sizeof(flags[0])) && matches; ++i) {
+            I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+            char* data = NULL;
+            I3ipctest_settings settings = i3ipctest_settings_save();
+            i3ipc_set_parseflags(flags[i]);
+            code = i3ipc_parse_try(msg, type + 1000, type, &data);
+            i3ipctest_settings_restore(&settings);
+            if (code) i3ipctest_reset_error(false);
+            free(msg);
+            
+            matches = (code != 0) == (code_orig != 0);
+            if (matches && !code) {
+                matches = i3ipctest_hash_generic(type, data) == hash_orig;
+            }
+            i3ipc_free(data);
+        }
+        if (matches && type == I3IPC_TYPE_REPLY_TREE) {
+            I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+            msg->message_type = I3IPC_REPLY_TREE;
+            
+            I3ipc_lazy_tree* tree = NULL;
+            I3ipc_lazy_tree* update = NULL;
+            code = i3ipc_parse_lazy_try(msg, &tree);
+            if (!code) code = i3ipctest_lazy_expand_all(tree, i3ipc_lazy_root(tree));
+            if (!code) code = i3ipc_parse_lazy_update_try(msg, tree, &update);
+            if (code) i3ipctest_reset_error(false);
+            free(msg);
+            
+            matches = (code != 0) == (code_orig != 0);
+            if (matches && !code) {
+                matches = i3ipctest_hash_generic(type, (char*)i3ipc_lazy_root(update)) == hash_orig;
+            }
+            i3ipc_lazy_free(tree);
+            i3ipc_lazy_free(update);
+        }
+        
+        i3ipc_set_allocator(NULL);
+        if (!matches || live) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse with an allocator does not match the default (code %d, %d, "
+                    "%d allocations left)\n", code_orig, code, live);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    int pool_flags[] = {0, I3IPC_PARSE_SINGLEPASS, I3IPC_PARSE_ZEROCOPY};
+    for (int i = 0; i < (int)(sizeof(pool_flags) / sizeof(pool_flags[0])); ++i) {
+        /* Parse twice with the reply pool. The second result must reuse the block of the first,
+         * which is scribbled over before it is released. */
+        I3ipctest_settings settings = i3ipctest_settings_save();
+        i3ipc_set_reply_pool(true);
+        i3ipc_set_parseflags(pool_flags[i]);
+        uint64_t hits_before = 0;
+        i3ipc_reply_pool_counters(&hits_before, NULL);
+
+        bool matches = true;
+        int code = 0;
+        for (int j = 0; j < 2 && matches; ++j) {
+            I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+            
+            char* data = NULL;
+            code = i3ipc_parse_try(msg, type + 1000, type, &data);
+            if (code) i3ipctest_reset_error(false);
+            free(msg);
+
+            matches = (code != 0) == (code_orig != 0);
+            if (matches && !code) {
+                matches = i3ipctest_hash_generic(type, data) == hash_orig;
+                memset(data, 0xff, i3ipc__type_get(type).size);
+            }
+            if (j == 0) {
+                i3ipc_reply_release(data);
+            } else {
+                uint64_t hits = 0;
+                i3ipc_reply_pool_counters(&hits, NULL);
+                if (matches && !code) matches = hits == hits_before + 1;
+                i3ipc_free(data);
+            }
+        }
+        i3ipctest_settings_restore(&settings);
+
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse with the reply pool and flags %x does not match the default "
+                    "(code %d, %d)\n", pool_flags[i], code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    {
+        /* Toggle the reply pool while results from with and without it are alive, then free them in
+         * every combination of the pool being enabled and release or i3ipc_free */
+        char* data[4] = {NULL, NULL, NULL, NULL};
+        I3ipctest_settings settings = i3ipctest_settings_save();
+        bool matches = true;
+        int code = 0;
+        for (int j = 0; j < 4 && matches; ++j) {
+            i3ipc_set_reply_pool(j % 2 == 0);
+            I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+            code = i3ipc_parse_try(msg, type + 1000, type, &data[j]);
+            if (code) i3ipctest_reset_error(false);
+            free(msg);
+            matches = (code != 0) == (code_orig != 0);
+        }
+        for (int j = 0; j < 4; ++j) {
+            /* Results 0 and 2 are from the pool, which is now in the opposite state for 0 and 1 */
+            i3ipc_set_reply_pool(j == 1 || j == 2);
+            if (matches && !code) matches = i3ipctest_hash_generic(type, data[j]) == hash_orig;
+            if (j < 2) {
+                i3ipc_free(data[j]);
+            } else {
+                i3ipc_reply_release(data[j]);
+            }
+        }
+        i3ipctest_settings_restore(&settings);
+
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse while toggling the reply pool does not match the default "
+                    "(code %d, %d)\n", code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    int generation_flags[] = {0, I3IPC_PARSE_SINGLEPASS, I3IPC_PARSE_PARALLEL};
+    for (int i = 0; i < (int)(sizeof(generation_flags) / sizeof(generation_flags[0])); ++i) {
+        /* With three generations, the result must survive two more staticalloc parses of another
+         * message, and be poisoned by the third */
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+        char const* other_json = "{\"success\":false}";
+        int other_size = (int)strlen(other_json);
+        I3ipc_message* other = (I3ipc_message*)calloc(sizeof(*other) + other_size + 1, 1);
+
+        I3ipctest_settings settings = i3ipctest_settings_save();
+        i3ipc_set_staticalloc(true);
+        i3ipc_set_staticalloc_generations(3);
+        i3ipc_set_staticalloc_poison(true);
+        i3ipc_set_parseflags(generation_flags[i]);
+        i3ipc__global_context.debug_parallel_always = true;
+        
+        char* data = NULL;
+        int code = i3ipc_parse_try(msg, type + 1000, type, &data);
+        if (code) i3ipctest_reset_error(false);
+        size_t type_size = i3ipc__type_get(type).size;
+        bool matches = (code != 0) == (code_orig != 0);
+        for (int j = 0; j < 3 && matches; ++j) {
+            other->message_type = 1000 + I3IPC_TYPE_REPLY_TICK;
+            other->message_length = other_size;
+            memcpy(other + 1, other_json, other_size + 1);
+            char* other_data = NULL;
+            matches = i3ipc_parse_try(other, other->message_type, I3IPC_TYPE_REPLY_TICK, &other_data) == 0
+                && !((I3ipc_reply_tick*)other_data)->success;
+            
+            if (matches && !code && j == 1) {
+                matches = i3ipctest_hash_generic(type, data) == hash_orig;
+            } else if (matches && !code && j == 2 && type_size > 16 && !generation_flags[i]) {
+                /* The start of the buffer was taken by the last result. (Arenas may free their
+                 * chunks when they are reset.) */
+                matches = (unsigned char)data[type_size - 1] == 0xa5;
+            }
+        }
+
+        i3ipctest_settings_restore(&settings);
+        free(msg);
+        free(other);
+        
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: parse with generations and flags %x does not match the default "
+                    "(code %d, %d)\n", generation_flags[i], code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+
+    if (type == I3IPC_TYPE_REPLY_TREE) {
+        /* Parse lazily, then expand every node */
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+        msg->message_type = I3IPC_REPLY_TREE;
+
+        I3ipc_lazy_tree* tree = NULL;
+        int code = i3ipc_parse_lazy_try(msg, &tree);
+        if (!code) code = i3ipctest_lazy_expand_all(tree, i3ipc_lazy_root(tree));
+        if (!code && !i3ipctest_lazy_check_raw(tree, i3ipc_lazy_root(tree))) code = -1;
+        if (code) i3ipctest_reset_error(false);
+        
+        bool matches = (code != 0) == (code_orig != 0);
+        if (matches && !code) {
+            matches = i3ipctest_hash_generic(type, (char*)i3ipc_lazy_root(tree)) == hash_orig;
+        }
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: lazy parse does not match the default (code %d, %d)\n",
+                    code_orig, code);
+            }
+            i3ipc_lazy_free(tree);
+            free(msg);
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+
+        /* Parse again, reusing the nodes of a tree from slightly different json (which has no
+         * nodes in common if it is malformed), then of that result, of the lazy tree, and of lazy
+         * trees with nothing and with only the root expanded, whose other nodes have to be decoded.
+         * The previous tree is freed before looking at the result, which must not depend on it. */
+        I3ipc_message* msg_modified = i3ipctest_tree_modify(msg);
+        I3ipc_lazy_tree* prev = NULL;
+        if (i3ipc_parse_lazy_update_try(msg_modified, NULL, &prev)) {
+            i3ipctest_reset_error(false);
+        }
+        free(msg_modified);
+        for (int i = 0; i < 5; ++i) {
+            if (i == 2) {
+                i3ipc_lazy_free(prev);
+                prev = tree;
+                tree = NULL;
+                if (code) {
+                    i3ipc_lazy_free(prev);
+                    prev = NULL;
+                }
+            } else if (i >= 3) {
+                i3ipc_lazy_free(prev);
+                prev = NULL;
+                int p_code = i3ipc_parse_lazy_try(msg, &prev);
+                if (!p_code && i == 4) p_code = i3ipc_lazy_expand_try(prev, i3ipc_lazy_root(prev));
+                if (p_code) i3ipctest_reset_error(false);
+            }
+            I3ipc_lazy_tree* update = NULL;
+            int i_code = i3ipc_parse_lazy_update_try(msg, prev, &update);
+            i3ipc_lazy_free(prev);
+            if (!i_code && !i3ipctest_lazy_check_raw(update, i3ipc_lazy_root(update))) i_code = -1;
+            if (i_code) i3ipctest_reset_error(false);
+            prev = update;
+            
+            matches = (i_code != 0) == (code_orig != 0);
+            if (matches && !i_code) {
+                matches = i3ipctest_hash_generic(type, (char*)i3ipc_lazy_root(update)) == hash_orig;
+            }
+            if (!matches) {
+                if (!silent) {
+                    fprintf(stderr, "Error: update %d does not match the default (code %d, %d)\n",
+                        i, code_orig, i_code);
+                }
+                break;
+            }
+        }
+        i3ipc_lazy_free(prev);
+        i3ipc_lazy_free(tree);
+        free(msg);
+        
+        if (!matches) return I3IPCTEST_VARIANT_NOMATCH;
+    }
+
+    if (type == I3IPC_TYPE_REPLY_TREE) {
+        /* Flatten the tree, which must not reference the message */
+        I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+        msg->message_type = I3IPC_REPLY_TREE;
+
+        I3ipc_flat_tree* tree = NULL;
+        int code = i3ipc_parse_flat_try(msg, &tree);
+        if (code) i3ipctest_reset_error(false);
+        free(msg);
+        
+        bool matches = (code != 0) == (code_orig != 0);
+        if (matches && !code) {
+            matches = i3ipctest_flat_check(tree, &tree->reply->root, 0, -1, false) == tree->size
+                && i3ipctest_hash_generic(type, (char*)tree->reply) == hash_orig;
+        }
+        i3ipc_flat_free(tree);
+        
+        if (!matches) {
+            if (!silent) {
+                fprintf(stderr, "Error: flat tree does not match the default (code %d, %d)\n",
+                    code_orig, code);
+            }
+            return I3IPCTEST_VARIANT_NOMATCH;
+        }
+    }
+    return 0;
+}
+
+/* Check that the projected node matches the full one, and that the other members are not set */
+bool i3ipctest_projection_check(I3ipc_node* node, I3ipc_node* full) {
+    if (node->id != full->id || node->focused != full->focused) return false;
+    if (node->name_size != full->name_size) return false;
+    if (node->name_size && memcmp(node->name, full->name, node->name_size)) return false;
+    if (node->marks || node->window_properties || node->rect.width || node->floating_nodes) return false;
+    
+    if (node->nodes_size != full->nodes_size) return false;
+    for (int i = 0; i < node->nodes_size; ++i) {
+        if (!i3ipctest_projection_check(&node->nodes[i], &full->nodes[i])) return false;
+    }
+    return true;
+}
+
+/* Parse a tree again with a projection of the nodes, and compare with the full parse in data */
+int i3ipctest_parse_projection_msg(I3ipc_message* msg_orig, char* data, bool silent) {
+    I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+    uint64_t mask = i3ipc_projection_mask(I3IPC_TYPE_NODE, "id name focused nodes");
+    uint64_t prev = i3ipc_set_projection(I3IPC_TYPE_NODE, mask);
+    char* data_proj = NULL;
+    int code = i3ipc_parse_try(msg, msg->message_type, I3IPC_TYPE_REPLY_TREE, &data_proj);
+    i3ipc_set_projection(I3IPC_TYPE_NODE, prev);
+    free(msg);
+
+    bool matches = !code && i3ipctest_projection_check(
+        &((I3ipc_reply_tree*)data_proj)->root, &((I3ipc_reply_tree*)data)->root
+    );
+    free(data_proj);
+    if (!matches) {
+        if (!silent) fprintf(stderr, "Error: projected parse does not match (code %d)\n", code);
+        return I3IPCTEST_VARIANT_NOMATCH;
+    }
+    return 0;
+}
+
+/* Parse a command or tick reply again with success projected away, which must also hold for the
+ * replies that take the fast path of i3ipc__parse_success */
+int i3ipctest_parse_projection_success_msg(I3ipc_message* msg_orig, int type, char* data, bool silent) {
+    I3ipc_message* msg = i3ipctest_msg_copy(msg_orig);
+
+    int proj_type = type == I3IPC_TYPE_REPLY_COMMAND ? I3IPC_TYPE_REPLY_COMMAND_EL : I3IPC_TYPE_REPLY_TICK;
+    uint64_t mask = type == I3IPC_TYPE_REPLY_COMMAND ? i3ipc_projection_mask(proj_type, "error") : 0;
+    uint64_t prev = i3ipc_set_projection(proj_type, mask);
+    char* data_proj = NULL;
+    int code = i3ipc_parse_try(msg, msg->message_type, type, &data_proj);
+    i3ipc_set_projection(proj_type, prev);
+    free(msg);
+
+    bool matches = !code;
+    if (matches && type == I3IPC_TYPE_REPLY_COMMAND) {
+        I3ipc_reply_command* proj = (I3ipc_reply_command*)data_proj;
+        I3ipc_reply_command* full = (I3ipc_reply_command*)data;
+        matches = proj->commands_size == full->commands_size;
+        for (int i = 0; matches && i < proj->commands_size; ++i) {
+            matches = !proj->commands[i].success;
+        }
+    } else if (matches) {
+        matches = !((I3ipc_reply_tick*)data_proj)->success;
+    }
+    free(data_proj);
+    if (!matches) {
+        if (!silent) fprintf(stderr, "Error: projected parse of success does not match (code %d)\n", code);
+        return I3IPCTEST_VARIANT_NOMATCH;
+    }
+    return 0;
+}
+
 int i3ipctest_parse_reparse_msg(I3ipc_message* msg, char** out_data, bool silent, uint64_t* out_hash) {
     int type = msg->message_type - 1000;
     
+    I3ipc_message* msg_bak = i3ipctest_msg_copy(msg);
+    
+    /* Without a connection to i3 every parse fails before looking at msg, so the variants could
+     * only be compared on that */
+    if (i3ipc_init_try(NULL)) {
+        if (!silent) {
+            fprintf(i3ipc__err, "while initialising for the original parse\n");
+            i3ipc_error_print("Error");
+        }
+
+        i3ipctest_reset_error(true);
+        free(msg_bak);
+        return I3IPCTEST_PARSE_FAIL;
+    }
+
     char* data;
     i3ipc_set_staticalloc(false);
     if (i3ipc_parse_try(msg, type + 1000, type, &data)) {
@@ -240,13 +1002,24 @@ int i3ipctest_parse_reparse_msg(I3ipc_message* msg, char** out_data, bool silent
             i3ipc_error_print("Error");
         }
         
-        return I3IPCTEST_PARSE_FAIL;
+        i3ipctest_reset_error(false);
+        int code = i3ipctest_parse_variants_msg(msg_bak, 1, 0, silent);
+        free(msg_bak);
+        return code ? code : I3IPCTEST_PARSE_FAIL;
     }
 
     if (out_data) *out_data = data;
 
     uint64_t hash2 = i3ipctest_hash_generic(type, data);
     if (out_hash) *out_hash = hash2;
+
+    {int code = i3ipctest_parse_variants_msg(msg_bak, 0, hash2, silent);
+    if (!code && type == I3IPC_TYPE_REPLY_TREE) code = i3ipctest_parse_projection_msg(msg_bak, data, silent);
+    if (!code && (type == I3IPC_TYPE_REPLY_COMMAND || type == I3IPC_TYPE_REPLY_TICK)) {
+        code = i3ipctest_parse_projection_success_msg(msg_bak, type, data, silent);
+    }
+    free(msg_bak);
+    if (code) return code;}
         
     I3ipc_message* msg2 = i3ipctest_gen_msg(type, data);
     size_t msg2_size = sizeof(*msg2) + msg2->message_length;
@@ -710,6 +1483,383 @@ void i3ipctest_primitive() {
     puts("");
 }
 
+void i3ipctest__bench_node(FILE* f, size_t* io_id, char const* type, char const* layout, int children, int leaves) {
+    size_t id = (*io_id)++;
+    bool leaf = children == 0;
+    fprintf(f, "{\"id\":%lu,\"type\":\"%s\",\"orientation\":\"%s\",\"scratchpad_state\":\"none\","
+        "\"percent\":%s,\"urgent\":false,\"focused\":false,\"layout\":\"%s\","
+        "\"workspace_layout\":\"default\",\"last_split_layout\":\"splith\",\"border\":\"%s\","
+        "\"current_border_width\":%d,\"rect\":{\"x\":%d,\"y\":0,\"width\":2560,\"height\":1440},"
+        "\"deco_rect\":{\"x\":0,\"y\":0,\"width\":0,\"height\":0},"
+        "\"window_rect\":{\"x\":2,\"y\":0,\"width\":2556,\"height\":1438},"
+        "\"geometry\":{\"x\":0,\"y\":0,\"width\":1920,\"height\":1080},\"name\":\"node %lu\",",
+        (unsigned long)id, type, leaf ? "none" : "horizontal", leaf ? "0.25" : "null", layout,
+        leaf ? "pixel" : "normal", leaf ? 2 : -1, (int)(id % 5120), (unsigned long)id);
+    if (leaf) {
+        fprintf(f, "\"window\":%lu,\"window_type\":\"normal\",\"window_properties\":{\"class\":"
+            "\"URxvt\",\"instance\":\"urxvt\",\"title\":\"~/src/i3ipc \\u2014 vim\","
+            "\"transient_for\":null},", (unsigned long)(id + 4194304));
+    } else {
+        fputs("\"window\":null,\"window_type\":null,", f);
+    }
+
+    fputs("\"nodes\":[", f);
+    size_t first = *io_id;
+    for (int i = 0; i < children; ++i) {
+        if (i) fputc(',', f);
+        char const* child_type = strcmp(type, "root") == 0 ? "output"
+            : strcmp(type, "output") == 0 ? "workspace" : "con";
+        i3ipctest__bench_node(f, io_id, child_type, "splitv", leaves, 0);
+    }
+    fprintf(f, "],\"floating_nodes\":[],\"focus\":[");
+    for (int i = 0; i < children && i < 4; ++i) fprintf(f, "%s%lu", i ? "," : "", (unsigned long)(first + i));
+    fputs("],\"fullscreen_mode\":0,\"sticky\":false,\"floating\":\"auto_off\",\"swallows\":[]}", f);
+}
+
+/* Generate a GET_TREE reply with outputs*workspaces*leaves windows, that looks like a real one. */
+I3ipc_message* i3ipctest_bench_tree(int outputs, int workspaces, int leaves, int* out_nodes) {
+    char* json_buf;
+    size_t json_size;
+    FILE* json_f = open_memstream(&json_buf, &json_size);
+    assert(json_f);
+
+    I3ipc_message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.message_type = 1000 + I3IPC_TYPE_REPLY_TREE;
+    fwrite(&msg, 1, sizeof(msg), json_f);
+    
+    size_t id = 94720166110912ul;
+    /* the root has the outputs as children, which have the workspaces, which have the leaves */
+    fprintf(json_f, "{\"id\":%lu,\"type\":\"root\",\"layout\":\"splith\",\"nodes\":[", (unsigned long)id++);
+    for (int i = 0; i < outputs; ++i) {
+        if (i) fputc(',', json_f);
+        i3ipctest__bench_node(json_f, &id, "output", "output", workspaces, leaves);
+    }
+    fputs("]}", json_f);
+    fputc(0, json_f);
+    fclose(json_f);
+
+    ((I3ipc_message*)json_buf)->message_length = json_size - sizeof(msg) - 1;
+    if (out_nodes) *out_nodes = 1 + outputs * (1 + workspaces * (1 + leaves));
+    return (I3ipc_message*)json_buf;
+}
+
+/* Generate a GET_CONFIG reply with a config file of about size bytes. */
+I3ipc_message* i3ipctest_bench_config(int size) {
+    char* json_buf;
+    size_t json_size;
+    FILE* json_f = open_memstream(&json_buf, &json_size);
+    assert(json_f);
+
+    I3ipc_message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.message_type = 1000 + I3IPC_TYPE_REPLY_CONFIG;
+    fwrite(&msg, 1, sizeof(msg), json_f);
+
+    fputs("{\"config\":\"# i3 config file (v4)\\n", json_f);
+    for (int i = 0; ftell(json_f) < size; ++i) {
+        fprintf(json_f, "bindsym $mod+Shift+%d move container to workspace number %d\\n"
+            "for_window [class=\\\"^Firefox$\\\" title=\\\"Library\\\"] floating enable\\n"
+            "exec --no-startup-id ~/.config/i3/scripts/startup.sh \\\"workspace %d\\\"\\n\\n", i, i, i);
+    }
+    fputs("\"}", json_f);
+    fputc(0, json_f);
+    fclose(json_f);
+
+    ((I3ipc_message*)json_buf)->message_length = json_size - sizeof(msg) - 1;
+    return (I3ipc_message*)json_buf;
+}
+
+double i3ipctest__bench_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Parse the message repeatedly in each of the modes, print the best time. If nodes is nonzero, the
+ * time per node is printed as well. */
+void i3ipctest__bench_msg(I3ipc_message* msg_orig, int type, int nodes, int iterations) {
+    size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+    I3ipc_message* msg = (I3ipc_message*)malloc(msg_size);
+
+    struct { char const* name; bool staticalloc; int parseflags; int simd; bool interpret; } modes[] = {
+        {"default",     false, 0,                  -1, false},
+        {"staticalloc", true,  0,                  -1, false},
+        {"stream",      false, I3IPC_PARSE_STREAM, -1, false},
+        {"scalar",      false, 0,                  I3IPC__SIMD_SCALAR, false},
+        {"single",      false, I3IPC_PARSE_SINGLEPASS, -1, false},
+        {"singlestatic", true, I3IPC_PARSE_SINGLEPASS, -1, false},
+        {"intern",      false, I3IPC_PARSE_INTERN, -1, false},
+        {"singleintern", false, I3IPC_PARSE_SINGLEPASS | I3IPC_PARSE_INTERN, -1, false},
+        {"zerocopy",    false, I3IPC_PARSE_ZEROCOPY, -1, false},
+        {"singlezero",  false, I3IPC_PARSE_SINGLEPASS | I3IPC_PARSE_ZEROCOPY, -1, false},
+        {"nondestruct", false, I3IPC_PARSE_NONDESTRUCTIVE, -1, false},
+        {"interpret",   false, 0,                  -1, true},
+        {"singleinterp", false, I3IPC_PARSE_SINGLEPASS, -1, true}
+    };
+    int modes_size = sizeof(modes) / sizeof(modes[0]);
+    
+    for (int i = 0; i < modes_size; ++i) {
+        i3ipc_set_staticalloc(modes[i].staticalloc);
+        i3ipc_set_parseflags(modes[i].parseflags);
+        i3ipc__simd_select(modes[i].simd);
+        i3ipc__global_context.debug_interpret = modes[i].interpret;
+
+        double best = 1e30;
+        size_t result_size = 0;
+        for (int j = 0; j < iterations; ++j) {
+            memcpy(msg, msg_orig, msg_size);
+            char* data;
+            double t0 = i3ipctest__bench_now();
+            int code = i3ipc_parse_try(msg, msg->message_type, type, &data);
+            double t1 = i3ipctest__bench_now();
+            if (code) { i3ipc_error_print("Error"); exit(1); }
+            if (!modes[i].staticalloc) {
+                result_size = malloc_usable_size(data);
+                free(data);
+            }
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        printf("  %-12s ", modes[i].name);
+        if (nodes) printf("%8.1f ns/node ", best * 1e9 / nodes);
+        printf("%8.1f MB/s", msg_orig->message_length / best * 1e-6);
+        if (result_size) printf(" %8.1f KiB", result_size / 1024.0);
+        puts("");
+    }
+    i3ipc_set_staticalloc(false);
+    i3ipc_set_parseflags(0);
+    i3ipc__simd_select(-1);
+    i3ipc__global_context.debug_interpret = false;
+
+    free(msg);
+}
+
+/* Follow the focus lists from node down to a leaf and return it. If tree is not NULL, the nodes on
+ * the way are expanded. */
+I3ipc_node* i3ipctest__bench_find_focused(I3ipc_lazy_tree* tree, I3ipc_node* node) {
+    while (true) {
+        if (tree && !i3ipc_lazy_expand(tree, node)) { i3ipc_error_print("Error"); exit(1); }
+        if (!node->focus_size) return node;
+        
+        I3ipc_node* next = NULL;
+        for (int i = 0; i < node->nodes_size; ++i) {
+            if (node->nodes[i].id == node->focus[0]) next = &node->nodes[i];
+        }
+        if (!next) return node;
+        node = next;
+    }
+}
+
+/* Compare finding the focused window after a full parse with doing so on a lazy tree, and after
+ * a parse projected onto the members needed. Finally, parse only the root, skipping everything
+ * else. */
+void i3ipctest__bench_focus(I3ipc_message* msg_orig, int iterations) {
+    size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+    I3ipc_message* msg = (I3ipc_message*)malloc(msg_size);
+
+    char const* names[] = {"focus full", "focus lazy", "focus proj", "root only"};
+    char const* fields[] = {NULL, NULL, "id focus nodes", "id name"};
+    for (int mode = 0; mode < 4; ++mode) {
+        bool lazy = mode == 1;
+        uint64_t mask = fields[mode] ? i3ipc_projection_mask(I3IPC_TYPE_NODE, fields[mode]) : ~(uint64_t)0;
+        i3ipc_set_projection(I3IPC_TYPE_NODE, mask);
+        
+        double best = 1e30;
+        for (int j = 0; j < iterations; ++j) {
+            memcpy(msg, msg_orig, msg_size);
+            double t0 = i3ipctest__bench_now();
+            I3ipc_reply_tree* data = NULL;
+            I3ipc_lazy_tree* tree = NULL;
+            int code;
+            if (lazy) {
+                msg->message_type = I3IPC_REPLY_TREE;
+                code = i3ipc_parse_lazy_try(msg, &tree);
+                if (!code) i3ipctest__bench_find_focused(tree, i3ipc_lazy_root(tree));
+            } else {
+                code = i3ipc_parse_try(msg, msg->message_type, I3IPC_TYPE_REPLY_TREE, (char**)&data);
+                if (!code) i3ipctest__bench_find_focused(NULL, &data->root);
+            }
+            double t1 = i3ipctest__bench_now();
+            if (code) { i3ipc_error_print("Error"); exit(1); }
+            free(data);
+            i3ipc_lazy_free(tree);
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        printf("  %-12s %8.1f us\n", names[mode], best * 1e6);
+    }
+    i3ipc_set_projection(I3IPC_TYPE_NODE, ~(uint64_t)0);
+
+    free(msg);
+}
+
+/* Collect the ids of the nodes with windows, like alttab does */
+int i3ipctest__bench_walk(I3ipc_node* node, size_t* out_ids) {
+    int count = 0;
+    if (node->window) out_ids[count++] = node->id;
+    for (int i = 0; i < node->nodes_size; ++i) {
+        count += i3ipctest__bench_walk(&node->nodes[i], out_ids + count);
+    }
+    for (int i = 0; i < node->floating_nodes_size; ++i) {
+        count += i3ipctest__bench_walk(&node->floating_nodes[i], out_ids + count);
+    }
+    return count;
+}
+
+/* Compare walking over all nodes of a tree with a loop over the flat tree */
+void i3ipctest__bench_flat(I3ipc_message* msg_orig, int nodes, int iterations) {
+    size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+    I3ipc_message* msg = (I3ipc_message*)malloc(msg_size);
+    memcpy(msg, msg_orig, msg_size);
+    msg->message_type = I3IPC_REPLY_TREE;
+    I3ipc_flat_tree* tree = NULL;
+    if (i3ipc_parse_flat_try(msg, &tree)) { i3ipc_error_print("Error"); exit(1); }
+    size_t* ids = (size_t*)malloc(nodes * sizeof(size_t));
+
+    char const* names[] = {"walk tree", "walk flat"};
+    int counts[2] = {0, 0};
+    for (int mode = 0; mode < 2; ++mode) {
+        double best = 1e30;
+        for (int j = 0; j < iterations; ++j) {
+            double t0 = i3ipctest__bench_now();
+            int count = 0;
+            if (mode == 0) {
+                count = i3ipctest__bench_walk(&tree->reply->root, ids);
+            } else {
+                for (int i = 0; i < tree->size; ++i) {
+                    if (tree->window[i]) ids[count++] = tree->id[i];
+                }
+            }
+            double t1 = i3ipctest__bench_now();
+            counts[mode] = count;
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        printf("  %-12s %8.2f us\n", names[mode], best * 1e6);
+    }
+    if (counts[0] != counts[1]) { fprintf(stderr, "Error: walks do not match\n"); exit(1); }
+
+    free(ids);
+    i3ipc_flat_free(tree);
+    free(msg);
+}
+
+/* Parse a tree after one window in it got focused, reusing the nodes of the tree before. Compare
+ * with parsing it from scratch. */
+void i3ipctest__bench_update(I3ipc_message* msg_orig, int iterations) {
+    size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+    I3ipc_message* msg = (I3ipc_message*)malloc(msg_size);
+    I3ipc_message* msg_next = (I3ipc_message*)malloc(msg_size);
+    memcpy(msg_next, msg_orig, msg_size);
+    msg_next->message_type = I3IPC_REPLY_TREE;
+
+    /* Focus the window in the middle, keeping the size of the json */
+    char* json = (char*)(msg_next + 1);
+    char const* pattern = "\"focused\":false";
+    int count = 0;
+    for (char* i = json; (i = strstr(i, pattern)); ++i) ++count;
+    char* focused = json;
+    for (int i = 0; i <= count / 2; ++i) focused = strstr(focused, pattern) + 1;
+    memcpy(focused - 1, "\"focused\":true ", strlen(pattern));
+
+    memcpy(msg, msg_orig, msg_size);
+    msg->message_type = I3IPC_REPLY_TREE;
+    I3ipc_lazy_tree* prev = NULL;
+    if (i3ipc_parse_lazy_update_try(msg, NULL, &prev)) { i3ipc_error_print("Error"); exit(1); }
+
+    char const* names[] = {"update full", "update none", "update one", "update same"};
+    for (int mode = 0; mode < 4; ++mode) {
+        double best = 1e30;
+        for (int j = 0; j < iterations; ++j) {
+            memcpy(msg, mode == 3 ? msg_orig : msg_next, msg_size);
+            msg->message_type = I3IPC_REPLY_TREE;
+            double t0 = i3ipctest__bench_now();
+            char* data = NULL;
+            I3ipc_lazy_tree* tree = NULL;
+            int code;
+            if (mode == 0) {
+                code = i3ipc_parse_try(msg, I3IPC_REPLY_TREE, I3IPC_TYPE_REPLY_TREE, &data);
+            } else {
+                code = i3ipc_parse_lazy_update_try(msg, mode == 1 ? NULL : prev, &tree);
+            }
+            double t1 = i3ipctest__bench_now();
+            if (code) { i3ipc_error_print("Error"); exit(1); }
+            free(data);
+            i3ipc_lazy_free(tree);
+            if (t1 - t0 < best) best = t1 - t0;
+        }
+        printf("  %-12s %8.1f us\n", names[mode], best * 1e6);
+    }
+
+    i3ipc_lazy_free(prev);
+    free(msg);
+    free(msg_next);
+}
+
+/* Parse trees of increasing size with I3IPC_PARSE_PARALLEL on 1, 2, 4, ... threads, up to the number
+ * of processors (but at least 2), and print the speedup over a single thread. */
+void i3ipctest__bench_parallel(int leaves, int iterations) {
+    int processors = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    printf("parallel: %d processors\n", processors);
+    i3ipc_set_parseflags(I3IPC_PARSE_PARALLEL);
+    
+    int sizes[] = {leaves / 4, leaves, 4 * leaves};
+    for (int i = 0; i < 3; ++i) {
+        int i_leaves = sizes[i] > 0 ? sizes[i] : 1;
+        int i_iterations = (int)((long)iterations * leaves / i_leaves / 4 + 1);
+        int nodes;
+        I3ipc_message* msg_orig = i3ipctest_bench_tree(2, 10, i_leaves, &nodes);
+        size_t msg_size = sizeof(*msg_orig) + msg_orig->message_length + 1;
+        I3ipc_message* msg = (I3ipc_message*)malloc(msg_size);
+
+        double base = 0;
+        for (int threads = 1; threads == 1 || threads <= processors || threads == 2; threads *= 2) {
+            i3ipc_set_parse_threads(threads);
+            double best = 1e30;
+            for (int j = 0; j < i_iterations; ++j) {
+                memcpy(msg, msg_orig, msg_size);
+                char* data;
+                double t0 = i3ipctest__bench_now();
+                int code = i3ipc_parse_try(msg, msg->message_type, I3IPC_TYPE_REPLY_TREE, &data);
+                double t1 = i3ipctest__bench_now();
+                if (code) { i3ipc_error_print("Error"); exit(1); }
+                free(data);
+                if (t1 - t0 < best) best = t1 - t0;
+            }
+            if (threads == 1) base = best;
+            printf("  %6d nodes %2d threads %10.1f us %6.2fx\n", nodes, threads, best * 1e6, base / best);
+        }
+        free(msg);
+        free(msg_orig);
+    }
+    i3ipc_set_parse_threads(0);
+    i3ipc_set_parseflags(0);
+}
+
+/* Parse a large synthetic tree and config repeatedly and report the time taken. */
+void i3ipctest_bench(char const* args[], int args_size) {
+    int leaves = args_size > 0 ? atoi(args[0]) : 50;
+    int iterations = args_size > 1 ? atoi(args[1]) : 200;
+
+    /* Make sure that the globals are initialised, so that the simd selection sticks */
+    if (i3ipc_init_try(NULL)) { i3ipc_error_print("Error"); exit(1); }
+    
+    int nodes;
+    I3ipc_message* msg = i3ipctest_bench_tree(2, 10, leaves, &nodes);
+    printf("tree: %d nodes, %lu bytes, %d iterations\n", nodes,
+        (unsigned long)msg->message_length, iterations);
+    i3ipctest__bench_msg(msg, I3IPC_TYPE_REPLY_TREE, nodes, iterations);
+    i3ipctest__bench_focus(msg, iterations);
+    i3ipctest__bench_update(msg, iterations);
+    i3ipctest__bench_flat(msg, nodes, iterations);
+    free(msg);
+
+    i3ipctest__bench_parallel(leaves, iterations);
+
+    msg = i3ipctest_bench_config(1 << 20);
+    printf("config: %lu bytes, %d iterations\n", (unsigned long)msg->message_length, iterations);
+    i3ipctest__bench_msg(msg, I3IPC_TYPE_REPLY_CONFIG, 0, iterations);
+    free(msg);
+}
+
 #define TERM_RED     "\x1b[31m"
 #define TERM_GREEN   "\x1b[32m"
 #define TERM_YELLOW  "\x1b[33m"
@@ -811,6 +1961,8 @@ int main(int argc, char const* argv[]) {
         i3ipctest_generate();
     } else if (strcmp(argv[1], "evaluate") == 0) {
         i3ipctest_evaluate(argv+2, argc-2);
+    } else if (strcmp(argv[1], "bench") == 0) {
+        i3ipctest_bench(argv+2, argc-2);
     }
 
     return 0;